@@ -0,0 +1,133 @@
+// bench: runner.exe /bench for platforms without MFC. Drives the host
+// pool, on the POSIX ipc backend and the epoll loop, against fakehost and
+// prints the same summary. Build both into one directory, from here:
+//
+//   R=../runner
+//   IPC="$R/sharefile.cpp $R/ring.cpp $R/protocol.cpp $R/ipc_posix.cpp"
+//   g++ -std=c++17 -O2 -pthread -o fakehost fakehost.cpp $IPC -lrt
+//   g++ -std=c++17 -O2 -pthread -o bench bench.cpp $R/bench.cpp $R/hostpool.cpp
+//     $R/eventloop.cpp $R/eventloop_epoll.cpp $IPC -lrt
+//
+//   bench <cases> [--workers=<n>] [--batch=<n>] [--standby=<n>]
+//         [--timeout=<ms>] [--stall=<ms>] [fakehost options...]
+//
+// Options the pool does not know go to fakehost. Ctrl+C cancels the run.
+// The exit codes are those of runner.exe /bench.
+
+#ifndef _WIN32
+
+#include "../runner/bench.h"
+#include "../runner/ipc.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static CIpcEvent* g_cancel = nullptr;
+
+static void onSignal(int)
+{
+  // A FIFO write, which is safe in a signal handler.
+  g_cancel->set();
+}
+
+static std::wstring widen(const std::string& str)
+{
+  return std::wstring(str.begin(), str.end());
+}
+
+static std::wstring hostPath(const char* self)
+{
+  std::string path = self;
+  size_t slash = path.rfind('/');
+  return widen(slash == std::string::npos ? "./fakehost" :
+    path.substr(0, slash + 1) + "fakehost");
+}
+
+int main(int argc, char* argv[])
+{
+  static const char* names[] = { "success", "fail", "crash", "error", "cancel", "timeout" };
+  int cases = argc > 1 ? atoi(argv[1]) : 0;
+  if (cases <= 0)
+  {
+    fprintf(stderr, "usage: bench <cases> [options]\n");
+    return 5;
+  }
+
+  HostPoolOptions options;
+  options.workers = 4;
+  options.batch = 64;
+  options.standby = 1;
+  options.startupTimeout = 10000;
+  options.stallTimeout = 5000;
+  std::wstring cmdLine = L"\"" + hostPath(argv[0]) + L"\"";
+  for (int i = 2; i < argc; i++)
+  {
+    const char* arg = argv[i];
+    const char* eq = strchr(arg, '=');
+    std::string name = eq ? std::string(arg, eq - arg) : std::string(arg);
+    uint32_t value = eq ? (uint32_t)strtoul(eq + 1, nullptr, 10) : 0;
+    if (name == "--workers")
+    {
+      options.workers = (int)value;
+    }
+    else if (name == "--batch")
+    {
+      options.batch = (int)value;
+    }
+    else if (name == "--standby")
+    {
+      options.standby = (int)value;
+    }
+    else if (name == "--timeout")
+    {
+      options.timeout = value;
+    }
+    else if (name == "--stall")
+    {
+      options.stallTimeout = value;
+    }
+    else
+    {
+      cmdLine += L" " + widen(arg);
+    }
+  }
+
+  std::wstring session = L"bench-" + std::to_wstring(CIpcProcess::currentId());
+  CIpcEvent cancel;
+  if (!cancel.create((L"Local\\ArxTester-" + session + L"-Cancel").c_str(), true))
+  {
+    fprintf(stderr, "bench: cannot create the cancel event\n");
+    return 5;
+  }
+  g_cancel = &cancel;
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  BenchResult result = runBenchPool(cmdLine, session, cases, options, cancel.handle());
+
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+
+  double overhead = (result.wallMs * result.workers - result.caseMs) / cases;
+  printf("# %s: %d cases, %d workers, %d hosts, %.3f s\n",
+    result.bFinished ? "finished" : "cancelled", cases, result.workers, result.launches,
+    result.wallMs / 1000);
+  printf("#");
+  for (int i = kCaseSuccess; i <= kCaseTimeout; i++)
+  {
+    printf(" %s %d", names[i], result.counts[i]);
+  }
+  printf("\n# %.1f cases/s, %.3f ms overhead per case\n",
+    result.wallMs > 0 ? cases * 1000 / result.wallMs : 0, overhead);
+  if (result.artifacts)
+  {
+    printf("# %d artifacts, %llu bytes\n", result.artifacts,
+      (unsigned long long)result.artifactBytes);
+  }
+  return result.bFinished ? 0 : 3;
+}
+
+#endif
@@ -0,0 +1,375 @@
+// fakehost: a stand-in for acad.exe + loader.arx that speaks the runner
+// protocol without AutoCAD, to measure the runner and its scheduler at
+// scale (runner.exe /bench). Every case sleeps for a simulated duration
+// and then passes, fails, crashes, hangs or freezes, as drawn from the
+// options below. The draw depends only on the case id and the seed, so
+// a rerun behaves the same.
+//
+//   --ms=<n>        mean case duration in ms (5)
+//   --jitter=<f>    durations vary uniformly by +-f of the mean (0.5)
+//   --startup=<n>   simulated boot time in ms (0)
+//   --fail=<p>      probability that a case fails (0)
+//   --crash=<p>     probability that a case kills the host (0)
+//   --hang=<p>      probability that a case never returns but keeps
+//                   pumping messages, like an open modal dialog; the host
+//                   still beats, so only its time budget catches it (0)
+//   --freeze=<p>    probability that the whole host stops, heartbeat
+//                   included, which the stall check catches (0)
+//   --log           send a log line per case
+//   --artifact=<n>  commit an artifact of n bytes per case (0)
+//   --seed=<n>      (0)
+
+#include "../runner/sharefile.h"
+#include "../runner/protocol.h"
+#include "../runner/status.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <deque>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+struct Options
+{
+  double ms = 5;
+  double jitter = 0.5;
+  double startup = 0;
+  double fail = 0;
+  double crash = 0;
+  double hang = 0;
+  double freeze = 0;
+  bool bLog = false;
+  size_t artifact = 0;
+  uint64_t seed = 0;
+};
+
+static std::wstring getEnv(const char* name)
+{
+  const char* value = getenv(name);
+  std::wstring str;
+  for (; value && *value; value++)
+  {
+    str += (wchar_t)(unsigned char)*value;
+  }
+  return str;
+}
+
+static bool isRunnerAlive(unsigned long pid)
+{
+  if (!pid)
+  {
+    return true;
+  }
+#ifdef _WIN32
+  HANDLE hRunner = OpenProcess(SYNCHRONIZE, FALSE, pid);
+  if (!hRunner)
+  {
+    return false;
+  }
+  bool bAlive = WAIT_TIMEOUT == WaitForSingleObject(hRunner, 0);
+  CloseHandle(hRunner);
+  return bAlive;
+#else
+  return kill((pid_t)pid, 0) == 0;
+#endif
+}
+
+// Artifacts the way loader.arx hands them over: an unnamed section whose
+// handle goes out in the frame and stays open until the runner counted
+// it in HostStatus::artifactsTaken.
+class CArtifacts
+{
+public:
+  CArtifacts()
+    : m_sent(0)
+  {
+  }
+
+  // A section of size bytes, filled with a pattern; 0 on failure.
+  uint64_t create(size_t size)
+  {
+#ifdef _WIN32
+    HANDLE hSection = CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+      (DWORD)((uint64_t)size >> 32), (DWORD)size, nullptr);
+    void* data = hSection ? MapViewOfFile(hSection, FILE_MAP_WRITE, 0, 0, size) : nullptr;
+    if (!data)
+    {
+      if (hSection)
+      {
+        CloseHandle(hSection);
+      }
+      return 0;
+    }
+    memset(data, 0xa5, size);
+    UnmapViewOfFile(data);
+    return (uint64_t)(uintptr_t)hSection;
+#else
+    int fd = memfd_create("artifact", MFD_CLOEXEC);
+    void* data = MAP_FAILED;
+    if (fd >= 0 && ftruncate(fd, (off_t)size) == 0)
+    {
+      data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (data == MAP_FAILED)
+    {
+      if (fd >= 0)
+      {
+        close(fd);
+      }
+      return 0;
+    }
+    memset(data, 0xa5, size);
+    munmap(data, size);
+    return (uint64_t)fd;
+#endif
+  }
+
+  void sent(uint64_t handle)
+  {
+    m_handles.push_back(handle);
+    m_sent++;
+  }
+
+  void release(const HostStatus* hs)
+  {
+    uint32_t open = (uint32_t)m_handles.size();
+    uint32_t taken = hs ? hs->artifactsTaken.load() - (m_sent - open) : 0;
+    for (uint32_t i = 0; i < taken && i < open; i++)
+    {
+      destroy(m_handles.front());
+      m_handles.pop_front();
+    }
+  }
+
+  static void destroy(uint64_t handle)
+  {
+#ifdef _WIN32
+    CloseHandle((HANDLE)(uintptr_t)handle);
+#else
+    close((int)handle);
+#endif
+  }
+
+private:
+  std::deque<uint64_t> m_handles;
+  uint32_t m_sent;
+};
+
+// splitmix64 from the case id: a few independent uniform draws in [0, 1)
+// per case.
+class CDraw
+{
+public:
+  CDraw(uint64_t id, uint64_t seed)
+    : m_state(id ^ (seed * 0x9e3779b97f4a7c15ULL))
+  {
+  }
+
+  double next()
+  {
+    uint64_t z = (m_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return (z >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+private:
+  uint64_t m_state;
+};
+
+static void sleepMs(double ms)
+{
+  std::this_thread::sleep_for(std::chrono::microseconds((int64_t)(ms * 1000)));
+}
+
+int main(int argc, char* argv[])
+{
+  Options opt;
+  for (int i = 1; i < argc; i++)
+  {
+    const char* arg = argv[i];
+    const char* eq = strchr(arg, '=');
+    double value = eq ? atof(eq + 1) : 0;
+    std::string name = eq ? std::string(arg, eq - arg) : std::string(arg);
+    if (name == "--ms")
+    {
+      opt.ms = value;
+    }
+    else if (name == "--jitter")
+    {
+      opt.jitter = value;
+    }
+    else if (name == "--startup")
+    {
+      opt.startup = value;
+    }
+    else if (name == "--fail")
+    {
+      opt.fail = value;
+    }
+    else if (name == "--crash")
+    {
+      opt.crash = value;
+    }
+    else if (name == "--hang")
+    {
+      opt.hang = value;
+    }
+    else if (name == "--freeze")
+    {
+      opt.freeze = value;
+    }
+    else if (name == "--log")
+    {
+      opt.bLog = true;
+    }
+    else if (name == "--artifact")
+    {
+      opt.artifact = (size_t)value;
+    }
+    else if (name == "--seed" && eq)
+    {
+      opt.seed = strtoull(eq + 1, nullptr, 10);
+    }
+  }
+
+  std::wstring channel = getEnv("ARXTESTER_CHANNEL");
+  unsigned long runner = wcstoul(getEnv("ARXTESTER_RUNNER").c_str(), nullptr, 10);
+  if (channel.empty())
+  {
+    return 1;
+  }
+
+  sleepMs(opt.startup);
+
+  CShareStatus status(channelStatusName(channel.c_str()).c_str(), true);
+  HostStatus* hs = status.get();
+  // Like loader.arx, beat only on the thread that runs the cases.
+  auto beat = [hs]
+  {
+    if (hs)
+    {
+      hs->heartbeat++;
+    }
+  };
+  beat();
+
+  // Parked until the runner assigns the queue, like loader.arx.
+  CIpcEvent start;
+  bool bStarted = start.open(channelStartName(channel.c_str()).c_str(), true);
+  while (bStarted && !start.wait(1000))
+  {
+    bStarted = isRunnerAlive(runner);
+    beat();
+  }
+
+  CShareFile cases(channelCaseName(channel.c_str()).c_str(), true);
+  CShareFile results(channelResultName(channel.c_str()).c_str(), true);
+  CArtifacts artifacts;
+  uint8_t buf[1024];
+  while (bStarted && cases.isValid() && results.isValid())
+  {
+    const void* data = nullptr;
+    uint32_t size = 0;
+    if (!cases.peek(data, size))
+    {
+      if (!cases.waitReadable(1000) && !isRunnerAlive(runner))
+      {
+        break;
+      }
+      beat();
+      continue;
+    }
+    if (size == 0)
+    {
+      break;
+    }
+
+    CFrameReader reader(data, size);
+    Frame frame;
+    bool bCase = reader.next(frame) && frame.type == kFrameCaseStart;
+    CDraw draw(bCase ? frame.id : 0, opt.seed);
+    cases.consume();
+    if (hs)
+    {
+      hs->cases++;
+    }
+    beat();
+
+    double ms = opt.ms * (1 + opt.jitter * (2 * draw.next() - 1));
+    sleepMs(ms);
+
+    // One draw picks the fate, so the probabilities add up.
+    double fate = draw.next();
+    if (fate < opt.crash)
+    {
+      std::_Exit(3);
+    }
+    fate -= opt.crash;
+    if (fate < opt.freeze + opt.hang)
+    {
+      bool bBeat = fate >= opt.freeze;
+      for (;;)
+      {
+        if (bBeat)
+        {
+          beat();
+        }
+        sleepMs(500);
+      }
+    }
+    fate -= opt.freeze + opt.hang;
+    bool bPass = bCase && fate >= opt.fail;
+
+    CFrameWriter writer(buf, sizeof(buf));
+    if (opt.bLog)
+    {
+      static const char16_t line[] = u"fake case done";
+      writer.log(kLogInfo, line, (uint32_t)(sizeof(line) / sizeof(line[0]) - 1));
+    }
+    artifacts.release(hs);
+    uint64_t artifact = opt.artifact ? artifacts.create(opt.artifact) : 0;
+    if (artifact)
+    {
+      static const char16_t name[] = u"fake.bin";
+      writer.artifact(name, (uint32_t)(sizeof(name) / sizeof(name[0]) - 1), artifact,
+        opt.artifact);
+    }
+    writer.caseEnd(bPass ? kCaseEndPass : kCaseEndFail, (uint32_t)ms);
+    bool bSent = true;
+    while (!results.write(writer.data(), (uint32_t)writer.size(), 1000))
+    {
+      if (!isRunnerAlive(runner))
+      {
+        bStarted = bSent = false;
+        break;
+      }
+      beat();
+    }
+    if (artifact)
+    {
+      if (bSent)
+      {
+        artifacts.sent(artifact);
+      }
+      else
+      {
+        CArtifacts::destroy(artifact);
+      }
+    }
+  }
+
+  return 0;
+}
@@ -7,6 +7,7 @@
 #include <tchar.h>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 #include "../inc/arxcase.h"
 #include "../inc/gutil.h"
 
@@ -30,6 +31,11 @@ public:
   {
     m_enabled = e;
   }
+
+  virtual Mode mode() const
+  {
+    return kDocument;
+  }
 };
 
 class CCreateFieldMtext : public CArxCase
@@ -86,6 +92,11 @@ public:
     return L"Create a line";
   }
 
+  virtual Mode mode() const
+  {
+    return kSideDatabase;
+  }
+
   virtual void run()
   {
     AcDbLinePtr pLine(createLine(), AcDb::kForWrite);
@@ -504,13 +515,26 @@ private:
 class CArxModule : public IArxModule
 {
   std::vector<IArxCase*> m_cases;
+  std::unordered_map<uint64_t, int> m_index;
+  bool m_bValid;
 public:
   CArxModule()
+    : m_bValid(true)
   {
     m_cases.emplace_back(new CCreateFieldMtext);
     m_cases.emplace_back(new CCreateLine);
     m_cases.emplace_back(new CListField);
     m_cases.emplace_back(new CReadField);
+
+    for (int i = 0; i < (int)m_cases.size(); i++)
+    {
+      if (!m_index.emplace(arxCaseId(arxName(), m_cases[i]->name()), i).second)
+      {
+        OutputDebugString(L"Case id collision: ");
+        OutputDebugString(m_cases[i]->name());
+        m_bValid = false;
+      }
+    }
   }
   ~CArxModule()
   {
@@ -544,10 +568,21 @@ public:
   {
     return m_cases.at(i);
   }
+
+  virtual int findCase(uint64_t id) const
+  {
+    auto it = m_index.find(id);
+    return it == m_index.end() ? -1 : it->second;
+  }
+
+  bool isValid() const
+  {
+    return m_bValid;
+  }
 };
 
 extern "C" __declspec(dllexport) IArxModule* __stdcall arx_module()
 {
   static CArxModule module;
-  return &module;
+  return module.isValid() ? &module : nullptr;
 }
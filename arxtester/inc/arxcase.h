@@ -1,13 +1,43 @@
 ﻿#ifndef ARXCASE_H
 #define ARXCASE_H
 
+#include <cstdint>
+
+// Stable id of a case: FNV-1a over "<arx>:<case>" in UTF-16 units. It is
+// constexpr, so a module can have the ids of its cases at compile time.
+constexpr uint64_t arxCaseId(const wchar_t* arx, const wchar_t* name)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (; *arx; arx++)
+  {
+    hash = (hash ^ (uint16_t)*arx) * 1099511628211ULL;
+  }
+  hash = (hash ^ (uint16_t)L':') * 1099511628211ULL;
+  for (; *name; name++)
+  {
+    hash = (hash ^ (uint16_t)*name) * 1099511628211ULL;
+  }
+  return hash;
+}
+
 class IArxCase
 {
 public:
+  // Where the loader runs a case. kDocument runs it in the current
+  // drawing. kSideDatabase runs it in a fresh in-memory database that is
+  // the working database for the case only. That mode suits cases that
+  // touch nothing but the database, and it costs no document.
+  enum Mode
+  {
+    kDocument = 0,
+    kSideDatabase,
+  };
+
   virtual const wchar_t* name() const = 0;
   virtual bool isEnabled() const = 0;
   virtual void setEnabled(bool e) = 0;
   virtual void run() = 0;
+  virtual Mode mode() const = 0;
 };
 
 class IArxModule
@@ -18,8 +48,15 @@ public:
   virtual const wchar_t* moduleName() const = 0;
   virtual int caseCount() const = 0;
   virtual IArxCase* caseAt(int i) const = 0;
+  // Index of the case with that id, or -1, in constant time.
+  virtual int findCase(uint64_t id) const = 0;
 };
 
+// A module exports its cases as
+//   extern "C" IArxModule* __stdcall arx_module();
+// It returns null when two of its cases have the same arxCaseId, since
+// findCase() could not tell them apart; the module is then not loaded.
+
 class IArxCases
 {
 public:
@@ -1,7 +1,10 @@
 #ifndef _GTEST_H_
 #define _GTEST_H_
 
-#include "arxmodule.h"
+#include "gutil.h"
+
+// Where a check is, as the wide strings CDebuger takes.
+#define GTEST_LOCATION_ __FILEW__, _CRT_WIDE(_CRT_STRINGIZE(__LINE__))
 
 //
 // ASSERT_* ϵеĶԣʧʱ˳ǰ
@@ -11,145 +14,157 @@
 #define EXPECT_EQ(val1, val2) \
   if (val1 != val2) \
   { \
-    gDebuger->failure_eq(#val1, #val1); \
+    gDebuger->failure_eq(_CRT_WIDE(#val1), _CRT_WIDE(#val2), GTEST_LOCATION_); \
   }
 
 #define EXPECT_NE(val1, val2) \
   if (val1 == val2) \
   { \
-    gDebuger->failure_ne(#val1, #val1); \
+    gDebuger->failure_ne(_CRT_WIDE(#val1), _CRT_WIDE(#val2), GTEST_LOCATION_); \
   }
 
 #define EXPECT_LE(val1, val2) \
   if (val1 > val2) \
   { \
-    gDebuger->failure_le(#val1, #val1); \
+    gDebuger->failure_le(_CRT_WIDE(#val1), _CRT_WIDE(#val2), GTEST_LOCATION_); \
   }
 
 #define EXPECT_LT(val1, val2) \
   if (val1 >= val2) \
   { \
-    gDebuger->failure_lt(#val1, #val1); \
+    gDebuger->failure_lt(_CRT_WIDE(#val1), _CRT_WIDE(#val2), GTEST_LOCATION_); \
   }
 
 #define EXPECT_GE(val1, val2) \
   if (val1 < val2) \
   { \
-    gDebuger->failure_ge(#val1, #val1); \
+    gDebuger->failure_ge(_CRT_WIDE(#val1), _CRT_WIDE(#val2), GTEST_LOCATION_); \
   }
 
 #define EXPECT_GT(val1, val2) \
   if (val1 <= val2) \
   { \
-    gDebuger->failure_gt(#val1, #val1); \
+    gDebuger->failure_gt(_CRT_WIDE(#val1), _CRT_WIDE(#val2), GTEST_LOCATION_); \
   }
 
 # define ASSERT_EQ(val1, val2) \
   if (val1 != val2) \
   { \
-    gDebuger->assert_eq(#val1, #val1); \
+    gDebuger->assert_eq(_CRT_WIDE(#val1), _CRT_WIDE(#val2), GTEST_LOCATION_); \
+    return; \
   }
 
 # define ASSERT_NE(val1, val2) \
   if (val1 == val2) \
   { \
-    gDebuger->assert_ne(#val1, #val1); \
+    gDebuger->assert_ne(_CRT_WIDE(#val1), _CRT_WIDE(#val2), GTEST_LOCATION_); \
+    return; \
   }
 
 # define ASSERT_LE(val1, val2) \
   if (val1 > val2) \
   { \
-    gDebuger->assert_le(#val1, #val1); \
+    gDebuger->assert_le(_CRT_WIDE(#val1), _CRT_WIDE(#val2), GTEST_LOCATION_); \
+    return; \
   }
 
 # define ASSERT_LT(val1, val2) \
   if (val1 >= val2) \
   { \
-    gDebuger->assert_lt(#val1, #val1); \
+    gDebuger->assert_lt(_CRT_WIDE(#val1), _CRT_WIDE(#val2), GTEST_LOCATION_); \
+    return; \
   }
 
 # define ASSERT_GE(val1, val2) \
   if (val1 < val2) \
   { \
-    gDebuger->assert_ge(#val1, #val1); \
+    gDebuger->assert_ge(_CRT_WIDE(#val1), _CRT_WIDE(#val2), GTEST_LOCATION_); \
+    return; \
   }
 
 # define ASSERT_GT(val1, val2) \
   if (val1 <= val2) \
   { \
-    gDebuger->assert_gt(#val1, #val1); \
+    gDebuger->assert_gt(_CRT_WIDE(#val1), _CRT_WIDE(#val2), GTEST_LOCATION_); \
+    return; \
   }
 
 #define EXPECT_STREQ(s1, s2) \
   if (AcString(s1) != s2) \
   { \
-    gDebuger->failure_eq(#s1, #s2); \
+    gDebuger->failure_eq(_CRT_WIDE(#s1), _CRT_WIDE(#s2), GTEST_LOCATION_); \
   }
 
 #define EXPECT_STRNE(s1, s2) \
   if (AcString(s1) == s2) \
   { \
-    gDebuger->failure_ne(#s1, #s2); \
+    gDebuger->failure_ne(_CRT_WIDE(#s1), _CRT_WIDE(#s2), GTEST_LOCATION_); \
   }
 
 #define EXPECT_STRCASEEQ(s1, s2) \
   if (AcString(s1).compareNoCase(s2) != 0) \
   { \
-    gDebuger->failure_eq(#s1, #s2); \
+    gDebuger->failure_eq(_CRT_WIDE(#s1), _CRT_WIDE(#s2), GTEST_LOCATION_); \
   }
 
 #define EXPECT_STRCASENE(s1, s2) \
   if (AcString(s1).compareNoCase(s2) == 0) \
   { \
-    gDebuger->failure_ne(#s1, #s2); \
+    gDebuger->failure_ne(_CRT_WIDE(#s1), _CRT_WIDE(#s2), GTEST_LOCATION_); \
   }
 
 #define ASSERT_STREQ(s1, s2) \
   if (AcString(s1) != s2) \
   { \
-    gDebuger->assert_eq(#s1, #s2); \
+    gDebuger->assert_eq(_CRT_WIDE(#s1), _CRT_WIDE(#s2), GTEST_LOCATION_); \
+    return; \
   }
 
 #define ASSERT_STRNE(s1, s2) \
   if (AcString(s1) == s2) \
   { \
-    gDebuger->assert_ne(#s1, #s2); \
+    gDebuger->assert_ne(_CRT_WIDE(#s1), _CRT_WIDE(#s2), GTEST_LOCATION_); \
+    return; \
   }
 
 #define ASSERT_STRCASEEQ(s1, s2) \
   if (AcString(s1).compareNoCase(s2) != 0) \
   { \
-    gDebuger->assert_eq(#s1, #s2); \
+    gDebuger->assert_eq(_CRT_WIDE(#s1), _CRT_WIDE(#s2), GTEST_LOCATION_); \
+    return; \
   }
 
 #define ASSERT_STRCASENE(s1, s2) \
   if (AcString(s1).compareNoCase(s2) == 0) \
   { \
-    gDebuger->assert_ne(#s1, #s2); \
+    gDebuger->assert_ne(_CRT_WIDE(#s1), _CRT_WIDE(#s2), GTEST_LOCATION_); \
+    return; \
   }
 
 #define EXPECT_DOUBLE_EQ(val1, val2) \
   if (val1 != val2) \
   { \
-    gDebuger->failure_eq(#val1, #val2); \
+    gDebuger->failure_eq(_CRT_WIDE(#val1), _CRT_WIDE(#val2), GTEST_LOCATION_); \
   }
 
 #define EXPECT_DOUBLE_NE(val1, val2) \
   if (val1 == val2) \
   { \
-    gDebuger->failure_ne(#val1, #val2); \
+    gDebuger->failure_ne(_CRT_WIDE(#val1), _CRT_WIDE(#val2), GTEST_LOCATION_); \
   }
 
 #define ASSERT_DOUBLE_EQ(val1, val2) \
   if (val1 != val2) \
   { \
-    gDebuger->assert_ne(#val1, #val2); \
+    gDebuger->assert_eq(_CRT_WIDE(#val1), _CRT_WIDE(#val2), GTEST_LOCATION_); \
+    return; \
   }
 
 #define ASSERT_DOUBLE_NE(val1, val2) \
   if (val1 == val2) \
   { \
-    gDebuger->assert_ne(#val1, #val2); \
+    gDebuger->assert_ne(_CRT_WIDE(#val1), _CRT_WIDE(#val2), GTEST_LOCATION_); \
+    return; \
   }
 
 // Defines a test.
@@ -10,12 +10,14 @@ typedef AcDbObjectPointer<AcDbField> AcDbFieldPtr;
 
 class CDebuger;
 class CDbHelper;
+class CArtifacts;
 
 class CGlobalUtil
 {
 public:
   virtual CDebuger* debuger() const = 0;
   virtual CDbHelper* dbHelper() const = 0;
+  virtual CArtifacts* artifacts() const = 0;
 };
 
 #define ACRX_CLASS_GLOBALUTIL ACRX_T("Global Utility")
@@ -48,6 +50,18 @@ public:
   virtual void assert_lt(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line) = 0;
   virtual void assert_ge(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line) = 0;
   virtual void assert_gt(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line) = 0;
+
+  // Records a named measurement of the case, such as a count or a time in
+  // ms; the runner logs it with the case.
+  virtual void metric(const ACHAR* name, double value) = 0;
+
+  // Tells the runner that a long case is still advancing. When the suite
+  // sets <StallTimeout> (off by default) and a case has reported progress,
+  // the runner treats it as hung as soon as it stops doing so for that many
+  // ms, instead of waiting out its time budget. It also keeps the host's
+  // heartbeat going, which a case that computes without pumping messages
+  // then needs at least that often.
+  virtual void progress(unsigned int steps = 1) = 0;
 };
 
 #define gDebuger \
@@ -62,4 +76,24 @@ public:
 #define gDbHelper \
 globalUtil->dbHelper()
 
+// Large outputs of a case, such as a saved drawing or a rendered image,
+// kept by the runner next to the result file under
+// <result>-artifacts\<case>\<name>.
+class CArtifacts
+{
+public:
+  // Maps `size` bytes of shared memory for the artifact `name`; the case
+  // writes its output straight into it. Returns nullptr on failure.
+  virtual void* create(const ACHAR* name, size_t size) = 0;
+  // Hands the first `size` bytes to the runner and unmaps the memory. The
+  // artifact is dropped when the host does not run under the runner.
+  virtual bool commit(void* data, size_t size) = 0;
+  // Unmaps the memory without keeping it. Whatever a case neither
+  // commits nor discards is dropped when it ends.
+  virtual void discard(void* data) = 0;
+};
+
+#define gArtifacts \
+globalUtil->artifacts()
+
 #endif //GUTIL_H
@@ -0,0 +1,159 @@
+#include "pch.h"
+#include "../runner/protocol.h"
+#include "../runner/status.h"
+#include "artifacts.h"
+#include "logstream.h"
+
+// The artifact frame goes out in turn with the log output; a runner that
+// does not drain it within this time is gone.
+static const DWORD kSendTimeout = 5000;
+
+CArtifactStore& CArtifactStore::instance()
+{
+  static CArtifactStore store;
+  return store;
+}
+
+CArtifactStore::CArtifactStore()
+  : m_status(nullptr)
+  , m_count(0)
+  , m_sentCount(0)
+{
+}
+
+CArtifactStore::~CArtifactStore()
+{
+  reset();
+}
+
+void CArtifactStore::attach(const CString& channel, HostStatus* status)
+{
+  reset();
+  // Sections the runner has not counted yet stay open until the process
+  // exits; the runner may still be reading the frames behind them.
+  std::lock_guard<std::mutex> send(m_sendMutex);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_channel = channel;
+  m_status = status;
+}
+
+void* CArtifactStore::create(const wchar_t* name, size_t size)
+{
+  if (!name || !*name || wcslen(name) >= MAX_PATH || !size)
+  {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  CString section;
+  if (!m_channel.IsEmpty())
+  {
+    section.Format(L"%s-Artifact-%u", (LPCTSTR)m_channel, m_count++);
+  }
+
+  ULONGLONG max = size;
+  HANDLE hSection = CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+    (DWORD)(max >> 32), (DWORD)max, section.IsEmpty() ? nullptr : (LPCTSTR)section);
+  if (!hSection)
+  {
+    return nullptr;
+  }
+
+  void* data = MapViewOfFile(hSection, FILE_MAP_WRITE, 0, 0, size);
+  if (!data)
+  {
+    CloseHandle(hSection);
+    return nullptr;
+  }
+
+  m_sections[data] = { hSection, CString(name), size };
+  return data;
+}
+
+bool CArtifactStore::commit(void* data, size_t size)
+{
+  Section section;
+  HostStatus* status = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_sections.find(data);
+    if (it == m_sections.end())
+    {
+      return false;
+    }
+    section = it->second;
+    m_sections.erase(it);
+    status = m_status;
+  }
+
+  UnmapViewOfFile(data);
+  size = (std::min)(size, section.size);
+
+  if (!status || !CLogStream::instance().isAttached())
+  {
+    CloseHandle(section.hSection);
+    return false;
+  }
+
+  std::vector<uint8_t> buf(64 + textSize(section.name.GetLength()));
+  CFrameWriter writer(buf.data(), buf.size());
+  writer.artifact((const char16_t*)(LPCTSTR)section.name, section.name.GetLength(),
+    (uint64_t)(ULONG_PTR)section.hSection, size);
+
+  // Output written before the commit stays ahead of the artifact.
+  std::lock_guard<std::mutex> send(m_sendMutex);
+  CLogStream& stream = CLogStream::instance();
+  stream.flush();
+  if (!stream.send(writer.data(), (DWORD)writer.size(), kSendTimeout))
+  {
+    CloseHandle(section.hSection);
+    return false;
+  }
+  m_sent.push_back(section.hSection);
+  m_sentCount++;
+  release();
+  return true;
+}
+
+void CArtifactStore::release()
+{
+  if (!m_status)
+  {
+    return;
+  }
+  // Counters wrap; only the distance between them matters.
+  uint32_t open = (uint32_t)m_sent.size();
+  uint32_t taken = m_status->artifactsTaken.load() - (m_sentCount - open);
+  for (uint32_t i = 0; i < (std::min)(taken, open); i++)
+  {
+    CloseHandle(m_sent.front());
+    m_sent.pop_front();
+  }
+}
+
+void CArtifactStore::discard(void* data)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_sections.find(data);
+  if (it != m_sections.end())
+  {
+    UnmapViewOfFile(it->first);
+    CloseHandle(it->second.hSection);
+    m_sections.erase(it);
+  }
+}
+
+void CArtifactStore::reset()
+{
+  {
+    std::lock_guard<std::mutex> send(m_sendMutex);
+    release();
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto& it : m_sections)
+  {
+    UnmapViewOfFile(it.first);
+    CloseHandle(it.second.hSection);
+  }
+  m_sections.clear();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+struct HostStatus;
+
+// Artifacts of the running case: each one is a pagefile-backed section
+// named after the channel that the case fills in place. On commit only
+// the host's own handle and the size travel over the result ring; the
+// runner duplicates the section out of this process itself, so the bytes
+// are never copied on the way. The handle stays open here until the
+// runner has counted the frame in HostStatus::artifactsTaken.
+class CArtifactStore
+{
+public:
+  static CArtifactStore& instance();
+
+  // Without a status block every artifact is dropped on commit.
+  void attach(const CString& channel, HostStatus* status);
+
+  void* create(const wchar_t* name, size_t size);
+  bool commit(void* data, size_t size);
+  void discard(void* data);
+  // Drops what the last case created but did not commit.
+  void reset();
+
+private:
+  // Closes the sections the runner is done with.
+  void release();
+
+  CArtifactStore();
+  ~CArtifactStore();
+
+  struct Section
+  {
+    HANDLE hSection;
+    CString name;
+    size_t size;
+  };
+
+  std::mutex m_mutex;
+  std::map<void*, Section> m_sections;
+  CString m_channel;
+  HostStatus* m_status;
+  unsigned int m_count;
+
+  // Sent sections the runner has yet to count, oldest first, and how many
+  // were sent in all. Frames go out under m_sendMutex so that the order
+  // here is the order on the ring.
+  std::mutex m_sendMutex;
+  std::list<HANDLE> m_sent;
+  uint32_t m_sentCount;
+};
@@ -0,0 +1,202 @@
+#include "pch.h"
+#include <DbgHelp.h>
+#include <malloc.h>
+#include "../inc/arxcase.h"
+#include "util.h"
+#include "artifacts.h"
+#include "fault.h"
+
+#pragma comment(lib, "dbghelp.lib")
+
+// STATUS_HEAP_CORRUPTION, which only ntstatus.h defines.
+static const DWORD kHeapCorruption = 0xC0000374;
+
+static const wchar_t* codeName(DWORD code)
+{
+  switch (code)
+  {
+  case EXCEPTION_ACCESS_VIOLATION: return L"access violation";
+  case EXCEPTION_ARRAY_BOUNDS_EXCEEDED: return L"array bounds exceeded";
+  case EXCEPTION_DATATYPE_MISALIGNMENT: return L"datatype misalignment";
+  case EXCEPTION_FLT_DIVIDE_BY_ZERO: return L"float divide by zero";
+  case EXCEPTION_FLT_INVALID_OPERATION: return L"float invalid operation";
+  case EXCEPTION_FLT_OVERFLOW: return L"float overflow";
+  case EXCEPTION_ILLEGAL_INSTRUCTION: return L"illegal instruction";
+  case EXCEPTION_IN_PAGE_ERROR: return L"in-page error";
+  case EXCEPTION_INT_DIVIDE_BY_ZERO: return L"integer divide by zero";
+  case EXCEPTION_INT_OVERFLOW: return L"integer overflow";
+  case EXCEPTION_PRIV_INSTRUCTION: return L"privileged instruction";
+  case EXCEPTION_STACK_OVERFLOW: return L"stack overflow";
+  case kHeapCorruption: return L"heap corruption";
+  default: return L"exception";
+  }
+}
+
+// "field.dll+0x1a2b", or the bare address outside any module.
+static CString where(void* address)
+{
+  CString str;
+  HMODULE hModule = nullptr;
+  wchar_t szPath[MAX_PATH] = { 0 };
+  if (GetModuleHandleEx(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+    GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCWSTR)address, &hModule) &&
+    GetModuleFileName(hModule, szPath, MAX_PATH))
+  {
+    const wchar_t* name = wcsrchr(szPath, L'\\');
+    str.Format(L"%s+0x%Ix", name ? name + 1 : szPath,
+      (ULONG_PTR)address - (ULONG_PTR)hModule);
+  }
+  else
+  {
+    str.Format(L"0x%p", address);
+  }
+  return str;
+}
+
+// Runs on the faulting stack; a stack overflow leaves it a single page,
+// so that case only records the code and the address.
+static int faultFilter(EXCEPTION_POINTERS* ep, CaseFault* fault)
+{
+  fault->code = ep->ExceptionRecord->ExceptionCode;
+  fault->address = ep->ExceptionRecord->ExceptionAddress;
+  if (fault->code == EXCEPTION_STACK_OVERFLOW)
+  {
+    fault->dumpFile[0] = L'\0';
+    return EXCEPTION_EXECUTE_HANDLER;
+  }
+
+  // The first frames are this filter and the exception dispatcher.
+  fault->frames = CaptureStackBackTrace(0, kMaxFaultFrames, fault->stack, nullptr);
+
+  if (fault->dumpFile[0])
+  {
+    HANDLE hFile = CreateFile(fault->dumpFile, GENERIC_WRITE, 0, nullptr,
+      CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, nullptr);
+    MINIDUMP_EXCEPTION_INFORMATION mei = { GetCurrentThreadId(), ep, FALSE };
+    if (hFile == INVALID_HANDLE_VALUE ||
+      !MiniDumpWriteDump(GetCurrentProcess(), GetCurrentProcessId(), hFile,
+        MiniDumpWithIndirectlyReferencedMemory, &mei, nullptr, nullptr))
+    {
+      fault->dumpFile[0] = L'\0';
+    }
+    if (hFile != INVALID_HANDLE_VALUE)
+    {
+      CloseHandle(hFile);
+    }
+  }
+  return EXCEPTION_EXECUTE_HANDLER;
+}
+
+static bool runCpp(IArxCase* c)
+{
+  try
+  {
+    c->run();
+    return true;
+  }
+  catch (...)
+  {
+  }
+  return false;
+}
+
+// No C++ objects in here: __try does not mix with their unwinding.
+static CaseOutcome runSeh(IArxCase* c, CaseFault* fault)
+{
+  __try
+  {
+    return runCpp(c) ? kCaseReturned : kCaseThrew;
+  }
+  __except (faultFilter(GetExceptionInformation(), fault))
+  {
+    return kCaseFaulted;
+  }
+}
+
+CaseOutcome runContained(IArxCase* c, CaseFault& fault)
+{
+  fault.code = 0;
+  fault.address = nullptr;
+  fault.frames = 0;
+  return runSeh(c, &fault);
+}
+
+bool isSurvivable(const CaseFault& fault, HMODULE hCaseModule)
+{
+  switch (fault.code)
+  {
+  case EXCEPTION_STACK_OVERFLOW:
+    // Restores the guard page; without it the next overflow is fatal.
+    if (!_resetstkoflw())
+    {
+      return false;
+    }
+    break;
+  case EXCEPTION_ACCESS_VIOLATION:
+  case EXCEPTION_ARRAY_BOUNDS_EXCEEDED:
+  case EXCEPTION_DATATYPE_MISALIGNMENT:
+  case EXCEPTION_FLT_DIVIDE_BY_ZERO:
+  case EXCEPTION_FLT_INVALID_OPERATION:
+  case EXCEPTION_FLT_OVERFLOW:
+  case EXCEPTION_ILLEGAL_INSTRUCTION:
+  case EXCEPTION_INT_DIVIDE_BY_ZERO:
+  case EXCEPTION_INT_OVERFLOW:
+  case EXCEPTION_PRIV_INSTRUCTION:
+    break;
+  default:
+    return false;
+  }
+
+  HMODULE hModule = nullptr;
+  return hCaseModule && GetModuleHandleEx(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+    GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCWSTR)fault.address, &hModule) &&
+    hModule == hCaseModule;
+}
+
+static void commitDump(const wchar_t* path)
+{
+  HANDLE hFile = CreateFile(path, GENERIC_READ, 0, nullptr, OPEN_EXISTING,
+    FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+  if (hFile == INVALID_HANDLE_VALUE)
+  {
+    return;
+  }
+
+  LARGE_INTEGER size = { 0 };
+  GetFileSizeEx(hFile, &size);
+  CArtifactStore& artifacts = CArtifactStore::instance();
+  void* data = size.QuadPart > 0 && size.QuadPart <= MAXDWORD ?
+    artifacts.create(L"fault.dmp", (size_t)size.QuadPart) : nullptr;
+  if (data)
+  {
+    DWORD read = 0;
+    if (ReadFile(hFile, data, (DWORD)size.QuadPart, &read, nullptr) && read == size.QuadPart)
+    {
+      artifacts.commit(data, read);
+    }
+    else
+    {
+      artifacts.discard(data);
+    }
+  }
+  CloseHandle(hFile);
+}
+
+void reportFault(const CaseFault& fault)
+{
+  AcString msg;
+  msg.format(L"Fault 0x%08X (%s) at %s", fault.code, codeName(fault.code),
+    (LPCTSTR)where(fault.address));
+  gDebuger->printInfo(msg, CDebuger::kError);
+
+  for (USHORT i = 0; i < fault.frames; i++)
+  {
+    msg.format(L"  %s", (LPCTSTR)where(fault.stack[i]));
+    gDebuger->printInfo(msg, CDebuger::kError);
+  }
+
+  if (fault.dumpFile[0])
+  {
+    commitDump(fault.dumpFile);
+  }
+}
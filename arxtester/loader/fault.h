@@ -0,0 +1,42 @@
+#pragma once
+
+class IArxCase;
+
+// Frames kept of the stack of a fault.
+const USHORT kMaxFaultFrames = 48;
+
+// A hardware exception raised by a case: an access violation, a stack
+// overflow and the like, which catch (...) does not see under /EHsc. It
+// is filled in by the exception filter, on the faulting stack, so it is
+// plain data that needs no allocation.
+struct CaseFault
+{
+  DWORD code;
+  void* address;
+  void* stack[kMaxFaultFrames];
+  USHORT frames;
+  // Where to write a minidump, set by the caller; emptied when writing
+  // it fails.
+  wchar_t dumpFile[MAX_PATH];
+};
+
+enum CaseOutcome
+{
+  kCaseReturned,
+  kCaseThrew,
+  kCaseFaulted,
+};
+
+// Runs the case under a structured exception handler.
+CaseOutcome runContained(IArxCase* c, CaseFault& fault);
+
+// Whether the host can go on with the next case after the fault. Only
+// faults in the code of the test module itself qualify; a fault inside
+// AutoCAD, heap corruption or a stack that cannot be restored end the
+// host.
+bool isSurvivable(const CaseFault& fault, HMODULE hCaseModule);
+
+// Logs the fault as error lines with the code, the faulting module and
+// offset and the stack, and hands its minidump, if any, to the runner as
+// the "fault.dmp" artifact.
+void reportFault(const CaseFault& fault);
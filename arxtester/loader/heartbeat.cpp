@@ -0,0 +1,65 @@
+#include "pch.h"
+#include "../runner/status.h"
+#include "heartbeat.h"
+
+CHeartbeat& CHeartbeat::instance()
+{
+  static CHeartbeat heartbeat;
+  return heartbeat;
+}
+
+CHeartbeat::CHeartbeat()
+  : m_status(nullptr)
+{
+}
+
+CHeartbeat::~CHeartbeat()
+{
+}
+
+void CHeartbeat::attach(HostStatus* status)
+{
+  if (m_status.exchange(status))
+  {
+    acedRemoveWatchWinMsg(onMessage);
+  }
+  if (status)
+  {
+    acedRegisterWatchWinMsg(onMessage);
+    beat();
+  }
+}
+
+void CHeartbeat::beat()
+{
+  HostStatus* status = m_status;
+  if (status)
+  {
+    status->heartbeat++;
+  }
+}
+
+void CHeartbeat::caseStarted()
+{
+  HostStatus* status = m_status;
+  if (status)
+  {
+    status->cases++;
+    status->heartbeat++;
+  }
+}
+
+void CHeartbeat::progress(unsigned int steps)
+{
+  HostStatus* status = m_status;
+  if (status)
+  {
+    status->progress += steps;
+    status->heartbeat++;
+  }
+}
+
+void CHeartbeat::onMessage(const MSG*)
+{
+  instance().beat();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+struct HostStatus;
+
+// Publishes the liveness of the host into the HostStatus block of its
+// channel, along with the progress the cases report. The heartbeat only
+// moves on the command thread, the one the cases run on: for every window
+// message it dispatches, at each step of the case loop, and with every
+// progress report. A case that hangs that thread therefore stops the
+// heartbeat and the runner's stall check ends the host. A case that
+// computes for longer than the stall timeout without pumping messages
+// has to report progress.
+class CHeartbeat
+{
+public:
+  static CHeartbeat& instance();
+
+  // Call on the command thread; hooks its message loop while attached.
+  void attach(HostStatus* status);
+  void beat();
+  void caseStarted();
+  void progress(unsigned int steps);
+
+private:
+  CHeartbeat();
+  ~CHeartbeat();
+
+  static void onMessage(const MSG* pMsg);
+
+private:
+  std::atomic<HostStatus*> m_status;
+};
@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "util.h"
+#include "isolation.h"
+
+// Every object the case opens for write or appends, by id. The pointer is
+// only used while the object is still open, when it is the live one.
+class CCaseIsolation::CReactor : public AcDbDatabaseReactor
+{
+public:
+  virtual void objectAppended(const AcDbDatabase*, const AcDbObject* pObj)
+  {
+    m_objects[pObj->objectId()] = pObj;
+  }
+
+  virtual void objectOpenedForModify(const AcDbDatabase*, const AcDbObject* pObj)
+  {
+    m_objects[pObj->objectId()] = pObj;
+  }
+
+  const std::map<AcDbObjectId, const AcDbObject*>& objects() const
+  {
+    return m_objects;
+  }
+
+private:
+  std::map<AcDbObjectId, const AcDbObject*> m_objects;
+};
+
+static void reportError(const AcString& msg)
+{
+  gDebuger->printInfo(msg, CDebuger::kError);
+}
+
+CCaseIsolation::CCaseIsolation(AcDbDatabase* pDb, bool bRollback)
+  : m_pDb(pDb)
+  , m_pTM(pDb ? pDb->transactionManager() : nullptr)
+  , m_base(0)
+  , m_depth(0)
+  , m_reactor(std::make_unique<CReactor>())
+  , m_bFinished(false)
+{
+  if (!m_pDb)
+  {
+    m_bFinished = true;
+    return;
+  }
+
+  m_pDb->addReactor(m_reactor.get());
+  if (m_pTM)
+  {
+    m_base = m_depth = m_pTM->numActiveTransactions();
+    if (bRollback && m_pTM->startTransaction())
+    {
+      m_depth = m_pTM->numActiveTransactions();
+    }
+  }
+}
+
+CCaseIsolation::~CCaseIsolation()
+{
+  finish();
+}
+
+bool CCaseIsolation::finish()
+{
+  if (m_bFinished)
+  {
+    return true;
+  }
+  m_bFinished = true;
+  m_pDb->removeReactor(m_reactor.get());
+
+  bool ret = true;
+  AcString msg;
+
+  // Objects held by a transaction are open legitimately until it ends.
+  std::set<const AcDbObject*> held;
+  AcArray<AcDbObject*> transacted;
+  if (m_pTM && m_pTM->numActiveTransactions() > 0 &&
+    Acad::eOk == m_pTM->getAllObjects(transacted))
+  {
+    for (int i = 0; i < transacted.length(); i++)
+    {
+      held.emplace(transacted[i]);
+    }
+  }
+
+  for (auto& it : m_reactor->objects())
+  {
+    AcDbObject* pObj = nullptr;
+    Acad::ErrorStatus es = acdbOpenObject(pObj, it.first, AcDb::kForRead, true);
+    if (es == Acad::eOk)
+    {
+      pObj->close();
+    }
+    else if (es == Acad::eWasOpenedForWrite && held.find(it.second) == held.end())
+    {
+      ACHAR handle[32] = { 0 };
+      it.first.handle().getIntoAsciiBuffer(handle, 32);
+      msg.format(L"Left open for write: %s %s", it.second->isA()->name(), handle);
+      reportError(msg);
+      const_cast<AcDbObject*>(it.second)->close();
+      ret = false;
+    }
+  }
+
+  if (m_pTM)
+  {
+    int active = m_pTM->numActiveTransactions();
+    if (active < m_depth)
+    {
+      reportError(L"Ended the transaction of the loader, changes are not rolled back");
+      ret = false;
+    }
+    else if (active > m_depth)
+    {
+      msg.format(L"Left %d transaction(s) running", active - m_depth);
+      reportError(msg);
+      ret = false;
+    }
+
+    // Leftovers of the case first; the outer transaction goes last and
+    // takes the changes of the case with it.
+    while (m_pTM->numActiveTransactions() > m_base)
+    {
+      if (Acad::eOk != m_pTM->abortTransaction())
+      {
+        reportError(L"Rollback failed");
+        ret = false;
+        break;
+      }
+    }
+  }
+  return ret;
+}
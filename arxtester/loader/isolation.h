@@ -0,0 +1,38 @@
+#pragma once
+
+// Keeps one case from leaking database state into the next one run by
+// the same host. While it lives, the changes of the case happen inside
+// an outer transaction on the database. finish() aborts that transaction,
+// which undoes them in proportion to what changed instead of reopening
+// the drawing.
+//
+// A rollback cannot go through objects that are still open, so every
+// object the case opened for write is tracked. finish() reports the ones
+// still open, closes them, and fails the case. The same happens when the
+// case ended the outer transaction itself or left transactions of its
+// own running.
+class CCaseIsolation
+{
+public:
+  // bRollback false only checks for open objects, for a side database
+  // that is thrown away anyway.
+  CCaseIsolation(AcDbDatabase* pDb, bool bRollback);
+  ~CCaseIsolation();
+  CCaseIsolation(const CCaseIsolation&) = delete;
+  CCaseIsolation& operator=(const CCaseIsolation&) = delete;
+
+  // Rolls back and returns false when the case left the database in a
+  // state it should not have, after logging why.
+  bool finish();
+
+private:
+  class CReactor;
+
+  AcDbDatabase* m_pDb;
+  AcDbTransactionManager* m_pTM;
+  // Transactions running before the case, and with the outer one.
+  int m_base;
+  int m_depth;
+  std::unique_ptr<CReactor> m_reactor;
+  bool m_bFinished;
+};
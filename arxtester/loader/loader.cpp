@@ -1,7 +1,16 @@
 ﻿#include "pch.h"
 #include "util.h"
+#include "logstream.h"
+#include "heartbeat.h"
+#include "artifacts.h"
+#include "modules.h"
+#include "sidedb.h"
+#include "isolation.h"
+#include "fault.h"
 #include "../inc/arxcase.h"
 #include "../runner/sharefile.h"
+#include "../runner/protocol.h"
+#include "../runner/status.h"
 
 static void exitAll(void *)
 {
@@ -34,78 +43,280 @@ static bool isInAcad()
   return CString(L"acad").CompareNoCase(fileName);
 }
 
+static CString hostChannel()
+{
+  wchar_t szChannel[MAX_PATH] = { 0 };
+  GetEnvironmentVariable(strChannelEnv, szChannel, MAX_PATH);
+  return szChannel;
+}
+
+static HANDLE openRunner()
+{
+  wchar_t szRunner[32] = { 0 };
+  if (GetEnvironmentVariable(strRunnerEnv, szRunner, 32))
+  {
+    return OpenProcess(SYNCHRONIZE, FALSE,
+      wcstoul(szRunner, nullptr, 10));
+  }
+  return nullptr;
+}
+
+static bool wantsMinidump()
+{
+  wchar_t szValue[8] = { 0 };
+  return GetEnvironmentVariable(strMinidumpEnv, szValue, 8) && wcscmp(szValue, L"1") == 0;
+}
+
+static bool isAlive(HANDLE hProcess)
+{
+  return !hProcess || WAIT_TIMEOUT == WaitForSingleObject(hProcess, 0);
+}
+
+// Parks the host until the runner assigns its cases. Returns false when
+// the runner went away in the meantime.
+static bool waitForCases(const CString& channel, HANDLE hRunner)
+{
+  HANDLE hStart = OpenEvent(SYNCHRONIZE, FALSE, channelStartName(channel).c_str());
+  if (hStart == nullptr)
+  {
+    return false;
+  }
+
+  HANDLE handles[2] = { hStart, hRunner };
+  DWORD objId = WaitForMultipleObjects(hRunner ? 2 : 1, handles, FALSE, INFINITE);
+  CloseHandle(hStart);
+  return objId == WAIT_OBJECT_0;
+}
+
+// Takes the next case off the queue, waiting for the runner to top it up
+// if need be. Returns false at the end of the queue or when the runner is
+// gone.
+static bool nextCase(CShareFile& sf, HANDLE hRunner, CString& arx, uint64_t& id)
+{
+  const void* data = nullptr;
+  uint32_t size = 0;
+  while (!sf.peek(data, size))
+  {
+    if (!sf.isValid() || (!sf.waitReadable(1000) && !isAlive(hRunner)))
+    {
+      return false;
+    }
+    CHeartbeat::instance().beat();
+  }
+
+  // An empty message ends the queue. A malformed entry still yields a
+  // (failing) case, so that results stay in step with the queue.
+  arx.Empty();
+  id = 0;
+  CFrameReader reader(data, size);
+  Frame frame;
+  if (reader.next(frame) && frame.type == kFrameCaseStart)
+  {
+    arx = CString((const wchar_t*)frame.text.data, (int)frame.text.length);
+    id = frame.id;
+  }
+  sf.consume();
+  return size != 0;
+}
+
+// Microseconds since `since`, which moves on to now.
+static uint64_t lapUs(LARGE_INTEGER& since)
+{
+  static LARGE_INTEGER freq = { 0 };
+  if (!freq.QuadPart)
+  {
+    QueryPerformanceFrequency(&freq);
+  }
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  uint64_t us = (uint64_t)((now.QuadPart - since.QuadPart) * 1000000 / freq.QuadPart);
+  since = now;
+  return us;
+}
+
+// Microseconds from the creation of this process until now.
+static uint64_t processAgeUs()
+{
+  FILETIME created, exited, kernel, user, now;
+  if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user))
+  {
+    return 0;
+  }
+  GetSystemTimePreciseAsFileTime(&now);
+  ULARGE_INTEGER from = { created.dwLowDateTime, created.dwHighDateTime };
+  ULARGE_INTEGER to = { now.dwLowDateTime, now.dwHighDateTime };
+  return to.QuadPart > from.QuadPart ? (to.QuadPart - from.QuadPart) / 10 : 0;
+}
+
+// Returns a CaseEndResult. timing gets every phase but hostStart.
+static uint32_t runCase(const CString& strDir, const CString& moduleName, uint64_t id,
+  bool bMinidump, DWORD& ms, CaseTiming& timing)
+{
+  if (moduleName.IsEmpty())
+  {
+    return kCaseEndFail;
+  }
+
+  LARGE_INTEGER lap;
+  QueryPerformanceCounter(&lap);
+  IArxModule* m = CModuleCache::instance().get(strDir + moduleName);
+  timing.load = lapUs(lap);
+  int i = m ? m->findCase(id) : -1;
+  if (i == -1)
+  {
+    return kCaseEndFail;
+  }
+
+  IArxCase* c = m->caseAt(i);
+  timing.lookup = lapUs(lap);
+  CString msg;
+  msg.Format(L"Case: %s", c->name());
+  OutputDebugString(msg);
+
+  std::unique_ptr<CSideDatabase> sideDb;
+  if (c->mode() == IArxCase::kSideDatabase)
+  {
+    sideDb = std::make_unique<CSideDatabase>();
+    if (!sideDb->isValid())
+    {
+      OutputDebugString(L"No side database");
+      return kCaseEndFail;
+    }
+  }
+
+  // The drawing is rolled back after every case, so the next case in this
+  // host starts from the same state.
+  CCaseIsolation isolation(acdbHostApplicationServices()->workingDatabase(), !sideDb);
+
+  CaseFault fault;
+  fault.dumpFile[0] = L'\0';
+  if (bMinidump)
+  {
+    wchar_t szTemp[MAX_PATH] = { 0 };
+    GetTempPath(MAX_PATH, szTemp);
+    swprintf_s(fault.dumpFile, L"%sarxtester-%u-%I64x.dmp", szTemp,
+      GetCurrentProcessId(), id);
+  }
+
+  timing.setup = lapUs(lap);
+  takeCheckFailures();
+  CaseOutcome outcome = runContained(c, fault);
+  timing.run = lapUs(lap);
+  ms = (DWORD)(timing.run / 1000);
+
+  if (outcome == kCaseFaulted)
+  {
+    reportFault(fault);
+    if (!isSurvivable(fault, GetModuleHandle(strDir + moduleName)))
+    {
+      // Nothing in this process can be trusted any more. The runner
+      // blames the case once the host is gone.
+      gDebuger->printInfo(L"The host cannot recover, ending it", CDebuger::kError);
+      CLogStream::instance().flush();
+      TerminateProcess(GetCurrentProcess(), fault.code);
+    }
+  }
+
+  uint32_t ret = outcome == kCaseFaulted ? kCaseEndFault :
+    outcome == kCaseReturned ? kCaseEndPass : kCaseEndFail;
+  // A failed check fails the case even when run() returns.
+  if (takeCheckFailures() && ret == kCaseEndPass)
+  {
+    ret = kCaseEndFail;
+  }
+  if (!isolation.finish() && ret == kCaseEndPass)
+  {
+    ret = kCaseEndFail;
+  }
+  sideDb.reset();
+  timing.teardown = lapUs(lap);
+  return ret;
+}
+
 static void cmd_asdf()
 {
   OutputDebugString(L"Command: ASDF");
 
+  CString channel = hostChannel();
+  if (channel.IsEmpty())
+  {
+    OutputDebugString(L"No runner channel");
+    return;
+  }
+
   HANDLE hLoader = GetModuleHandle(
     isInAcad() ? L"loader.arx" : L"loader.grx");
   CString strDir = appDir(hLoader);
 
-  CShareFile sf(strCaseName, true);
-  CString str = sf.readLine();
-  int pos = str.Find(L':');
-  if (pos == -1)
+  // Boot time of the host: from process creation to taking cases.
+  uint64_t hostStart = processAgeUs();
+
+  CShareStatus status(channelStatusName(channel).c_str(), true);
+  CHeartbeat& heartbeat = CHeartbeat::instance();
+  heartbeat.attach(status.get());
+
+  HANDLE hRunner = openRunner();
+  if (!waitForCases(channel, hRunner))
   {
+    heartbeat.attach(nullptr);
+    if (hRunner)
+    {
+      CloseHandle(hRunner);
+    }
+    acDocManager->executeInApplicationContext(exitAll, nullptr);
+    return;
   }
-  else
+
+  CShareFile sf(channelCaseName(channel).c_str(), true);
+  CShareFile rf(channelResultName(channel).c_str(), true);
+  CLogStream& stream = CLogStream::instance();
+  stream.attach(&rf);
+  CArtifactStore& artifacts = CArtifactStore::instance();
+  artifacts.attach(channel, status.get());
+
+  // Work through the whole queue in this host, reporting every case as
+  // soon as it finishes. A fault the loader contains is reported like any
+  // other result; a crash ends the host, and the runner relaunches it for
+  // the cases after the one that crashed.
+  bool bMinidump = wantsMinidump();
+  CString arx;
+  uint64_t id = 0;
+  while (nextCase(sf, hRunner, arx, id))
   {
-    CString moduleName = str.Left(pos);
-    CString caseName = str.Mid(pos + 1);
+    DWORD ms = 0;
+    CaseTiming timing = { 0 };
+    timing.hostStart = hostStart;
+    hostStart = 0;
+    heartbeat.caseStarted();
+    uint32_t ret = runCase(strDir, arx, id, bMinidump, ms, timing);
+    artifacts.reset();
 
-    str.Format(L"Load: %s%s", strDir, moduleName);
-    OutputDebugString(str);
-    HMODULE hArx = LoadLibrary(strDir + moduleName);
-    if (hArx)
+    // The output of the case goes before its result. The runner drains
+    // results as they come, so a full ring only means it is gone.
+    stream.flush();
+    uint8_t buf[128];
+    CFrameWriter writer(buf, sizeof(buf));
+    writer.timing(timing);
+    writer.caseEnd(ret, ms);
+    while (!stream.send(writer.data(), (DWORD)writer.size(), 1000))
     {
-      OutputDebugString(L"Loaded");
-      typedef IArxModule* (WINAPI *ARXMODULE)();
-      ARXMODULE fun = (ARXMODULE)GetProcAddress(hArx, "arx_module");
-      if (fun)
+      if (!rf.isValid() || !isAlive(hRunner))
       {
-        OutputDebugString(L"Arx module");
-        IArxModule* m = fun();
-        if (m)
-        {
-          for (int i = 0; i < m->caseCount(); i++)
-          {
-            IArxCase* c = m->caseAt(i);
-            if (c->name() == caseName)
-            {
-              str.Format(L"Case: %s", caseName);
-              OutputDebugString(str);
-
-              CString ret = L"0";
-              try
-              {
-                c->run();
-                ret = L"1";
-              }
-              catch (...)
-              {
-              }
-
-              sf.reset();
-              sf.writeLine(ret);
-              const wchar_t strEvent[] = L"Global-Gstarcad Cases";
-              HANDLE hEvent = OpenEvent(EVENT_MODIFY_STATE, TRUE, strEvent);
-              if (hEvent)
-              {
-                SetEvent(hEvent);
-                CloseHandle(hEvent);
-              }
-
-              acDocManager->executeInApplicationContext(exitAll, nullptr);
-
-              break;
-            }
-          }
-          hArx = nullptr;
-        }
+        break;
       }
-      FreeLibrary(hArx);
+      heartbeat.beat();
     }
   }
+
+  artifacts.attach(CString(), nullptr);
+  stream.attach(nullptr);
+  heartbeat.attach(nullptr);
+  if (hRunner)
+  {
+    CloseHandle(hRunner);
+  }
+
+  acDocManager->executeInApplicationContext(exitAll, nullptr);
 }
 
 static void cmd_subasdf()
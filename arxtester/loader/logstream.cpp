@@ -0,0 +1,110 @@
+#include "pch.h"
+#include "../runner/sharefile.h"
+#include "../runner/protocol.h"
+#include "logstream.h"
+
+static const size_t kBufferSize = 16 * 1024;
+static const ULONGLONG kFlushInterval = 100;
+// How long a flush waits for room before the output is dropped; a case
+// must never hang on its own logging.
+static const DWORD kSendTimeout = 5000;
+
+struct CLogBuffer
+{
+  CLogBuffer()
+    : writer(data, sizeof(data))
+    , lastSend(GetTickCount64())
+  {
+  }
+
+  std::mutex mutex;
+  uint8_t data[kBufferSize];
+  CFrameWriter writer;
+  ULONGLONG lastSend;
+};
+
+static thread_local CLogBuffer* t_buffer = nullptr;
+
+CLogStream& CLogStream::instance()
+{
+  static CLogStream stream;
+  return stream;
+}
+
+CLogStream::CLogStream()
+  : m_ring(nullptr)
+{
+}
+
+CLogStream::~CLogStream()
+{
+}
+
+void CLogStream::attach(CShareFile* ring)
+{
+  flush();
+  std::lock_guard<std::mutex> lock(m_sendMutex);
+  m_ring = ring;
+}
+
+bool CLogStream::isAttached() const
+{
+  return m_ring != nullptr;
+}
+
+CLogBuffer& CLogStream::local()
+{
+  if (!t_buffer)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_buffers.emplace_back(std::make_unique<CLogBuffer>());
+    t_buffer = m_buffers.back().get();
+  }
+  return *t_buffer;
+}
+
+void CLogStream::write(uint32_t level, const wchar_t* text, size_t length)
+{
+  CLogBuffer& buffer = local();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+
+  // Anything longer than a whole buffer is cut.
+  size_t room = (kBufferSize - 8 - sizeof(uint32_t) * 2) / sizeof(char16_t);
+  uint32_t count = (uint32_t)(std::min)(length, room);
+  if (!buffer.writer.log(level, (const char16_t*)text, count))
+  {
+    send(buffer);
+    buffer.writer.log(level, (const char16_t*)text, count);
+  }
+
+  if (level >= kLogError || GetTickCount64() - buffer.lastSend >= kFlushInterval)
+  {
+    send(buffer);
+  }
+}
+
+void CLogStream::flush()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto& it : m_buffers)
+  {
+    std::lock_guard<std::mutex> bufferLock(it->mutex);
+    send(*it);
+  }
+}
+
+bool CLogStream::send(const void* data, DWORD size, DWORD timeout)
+{
+  std::lock_guard<std::mutex> lock(m_sendMutex);
+  return m_ring && m_ring->write(data, size, timeout);
+}
+
+void CLogStream::send(CLogBuffer& buffer)
+{
+  if (buffer.writer.size())
+  {
+    send(buffer.writer.data(), (DWORD)buffer.writer.size(), kSendTimeout);
+  }
+  buffer.writer.clear();
+  buffer.lastSend = GetTickCount64();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+class CShareFile;
+struct CLogBuffer;
+
+// Output of the running case, streamed to the runner as log frames over
+// the result ring. Every thread appends to a buffer of its own; a buffer
+// goes out as one message when it fills up, when it is older than
+// kFlushInterval, on errors, and before the case reports its end. Without
+// a runner the output goes to the command line as before.
+class CLogStream
+{
+public:
+  static CLogStream& instance();
+
+  void attach(CShareFile* ring);
+  bool isAttached() const;
+
+  void write(uint32_t level, const wchar_t* text, size_t length);
+  // Sends the buffers of all threads.
+  void flush();
+
+  // Writes a message of its own, such as a case result, in turn with the
+  // log buffers: the ring has a single producer.
+  bool send(const void* data, DWORD size, DWORD timeout);
+
+private:
+  CLogStream();
+  ~CLogStream();
+
+  CLogBuffer& local();
+  void send(CLogBuffer& buffer);
+
+private:
+  std::mutex m_mutex;
+  std::vector<std::unique_ptr<CLogBuffer>> m_buffers;
+  std::mutex m_sendMutex;
+  CShareFile* m_ring;
+};
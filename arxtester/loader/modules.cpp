@@ -0,0 +1,53 @@
+#include "pch.h"
+#include "../inc/arxcase.h"
+#include "modules.h"
+
+CModuleCache& CModuleCache::instance()
+{
+  static CModuleCache cache;
+  return cache;
+}
+
+CModuleCache::CModuleCache()
+{
+}
+
+CModuleCache::~CModuleCache()
+{
+  // The modules are left to process exit, like AutoCAD does with arx
+  // applications: their statics may still be referenced by the host.
+}
+
+IArxModule* CModuleCache::get(const CString& path)
+{
+  CString key = path;
+  key.MakeLower();
+  auto it = m_modules.find(key);
+  if (it != m_modules.end())
+  {
+    return it->second;
+  }
+
+  CString msg;
+  msg.Format(L"Load: %s", (LPCTSTR)path);
+  OutputDebugString(msg);
+
+  HMODULE hModule = LoadLibrary(path);
+  if (!hModule)
+  {
+    return nullptr;
+  }
+
+  typedef IArxModule* (WINAPI *ARXMODULE)();
+  ARXMODULE fun = (ARXMODULE)GetProcAddress(hModule, "arx_module");
+  IArxModule* module = fun ? fun() : nullptr;
+  if (!module)
+  {
+    OutputDebugString(L"No arx_module, or two of its cases have the same id");
+    FreeLibrary(hModule);
+    return nullptr;
+  }
+
+  m_modules[key] = module;
+  return module;
+}
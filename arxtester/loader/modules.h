@@ -0,0 +1,24 @@
+#pragma once
+
+struct IArxModule;
+
+// Test modules stay loaded for the life of the host: a module is mapped
+// and asked for its IArxModule once, and later cases of the same module
+// reuse it. A module is never freed or reloaded while the host runs, as
+// cases and AutoCAD may still hold pointers into it; Windows keeps the DLL
+// locked meanwhile. A rebuilt module is picked up by the next host, and
+// the runner starts a fresh one for every batch.
+class CModuleCache
+{
+public:
+  static CModuleCache& instance();
+
+  // The module of the DLL at path, or nullptr when it cannot be loaded.
+  IArxModule* get(const CString& path);
+
+private:
+  CModuleCache();
+  ~CModuleCache();
+
+  std::map<CString, IArxModule*> m_modules;
+};
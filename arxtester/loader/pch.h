@@ -51,6 +51,11 @@
 #include <list>
 #include <string>
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
 
 #include <arxHeaders.h>
 #include <adui.h>
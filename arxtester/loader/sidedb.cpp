@@ -0,0 +1,22 @@
+#include "pch.h"
+#include "sidedb.h"
+
+CSideDatabase::CSideDatabase()
+  : m_pDb(nullptr)
+  , m_pPrevDb(acdbHostApplicationServices()->workingDatabase())
+{
+  // Default drawing contents (tables, model space), no document.
+  m_pDb = new AcDbDatabase(true, true);
+  acdbHostApplicationServices()->setWorkingDatabase(m_pDb);
+}
+
+CSideDatabase::~CSideDatabase()
+{
+  acdbHostApplicationServices()->setWorkingDatabase(m_pPrevDb);
+  delete m_pDb;
+}
+
+bool CSideDatabase::isValid() const
+{
+  return m_pDb && acdbHostApplicationServices()->workingDatabase() == m_pDb;
+}
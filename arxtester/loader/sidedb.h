@@ -0,0 +1,20 @@
+#pragma once
+
+// A fresh in-memory drawing that is the working database while it lives,
+// for cases that run in IArxCase::kSideDatabase mode. No document is
+// opened or closed for it; the database is deleted with the object and
+// the previous working database is restored.
+class CSideDatabase
+{
+public:
+  CSideDatabase();
+  ~CSideDatabase();
+  CSideDatabase(const CSideDatabase&) = delete;
+  CSideDatabase& operator=(const CSideDatabase&) = delete;
+
+  bool isValid() const;
+
+private:
+  AcDbDatabase* m_pDb;
+  AcDbDatabase* m_pPrevDb;
+};
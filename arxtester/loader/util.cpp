@@ -1,5 +1,46 @@
 ﻿#include "pch.h"
+#include "../runner/protocol.h"
 #include "util.h"
+#include "logstream.h"
+#include "heartbeat.h"
+#include "artifacts.h"
+
+// Checks and metrics go out in turn with the log output; a runner that
+// does not take them within this time is gone.
+static const DWORD kSendTimeout = 5000;
+
+// Checks that failed since takeCheckFailures() was last called.
+static std::atomic<unsigned int> s_checkFailures(0);
+
+unsigned int takeCheckFailures()
+{
+  return s_checkFailures.exchange(0);
+}
+
+// A failed check: the runner gets it as an assertion frame, and the case
+// it belongs to fails.
+static void reportCheck(const wchar_t* op, const ACHAR* m1, const ACHAR* m2,
+  const ACHAR* file, const ACHAR* line)
+{
+  s_checkFailures++;
+  AcString msg;
+  msg.format(L"expected %s %s %s", m1 ? m1 : L"", op, m2 ? m2 : L"");
+
+  CLogStream& stream = CLogStream::instance();
+  if (!stream.isAttached())
+  {
+    acutPrintf(L"\n%s(%s): %s", file ? file : L"", line ? line : L"", msg.constPtr());
+    return;
+  }
+
+  uint32_t fileLength = file ? (uint32_t)wcslen(file) : 0;
+  std::vector<uint8_t> buf(64 + textSize(msg.length()) + textSize(fileLength));
+  CFrameWriter writer(buf.data(), buf.size());
+  writer.assertion((const char16_t*)msg.constPtr(), msg.length(),
+    (const char16_t*)file, fileLength, line ? (uint32_t)_wtoi(line) : 0);
+  stream.flush();
+  stream.send(writer.data(), (DWORD)writer.size(), kSendTimeout);
+}
 
 class CDebugerImpl : public CDebuger
 {
@@ -23,6 +64,9 @@ public:
   virtual void assert_lt(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line);
   virtual void assert_ge(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line);
   virtual void assert_gt(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line);
+
+  virtual void metric(const ACHAR* name, double value);
+  virtual void progress(unsigned int steps = 1);
 };
 
 class CDbHelperImpl : public CDbHelper
@@ -31,10 +75,19 @@ public:
   virtual AcDbObjectId addToModelSpace(AcDbEntity* pEntity);
 };
 
+class CArtifactsImpl : public CArtifacts
+{
+public:
+  virtual void* create(const ACHAR* name, size_t size);
+  virtual bool commit(void* data, size_t size);
+  virtual void discard(void* data);
+};
+
 CGlobalUtilImpl::CGlobalUtilImpl()
 {
   m_debuger = std::make_unique<CDebugerImpl>();
   m_dbHelper = std::make_unique<CDbHelperImpl>();
+  m_artifacts = std::make_unique<CArtifactsImpl>();
 }
 
 CDebuger* CGlobalUtilImpl::debuger() const
@@ -47,9 +100,24 @@ CDbHelper* CGlobalUtilImpl::dbHelper() const
   return m_dbHelper.get();
 }
 
-void CDebugerImpl::printInfo(const AcString& msg, MessageLevel)
+CArtifacts* CGlobalUtilImpl::artifacts() const
 {
-  acutPrintf(msg);
+  return m_artifacts.get();
+}
+
+void CDebugerImpl::printInfo(const AcString& msg, MessageLevel level)
+{
+  // Under the runner the output is streamed to it instead of going
+  // through the command line.
+  CLogStream& stream = CLogStream::instance();
+  if (stream.isAttached())
+  {
+    stream.write(level, msg.constPtr(), msg.length());
+  }
+  else
+  {
+    acutPrintf(msg);
+  }
 }
 
 void CDebugerImpl::printError(Acad::ErrorStatus es, const AcString& prefex)
@@ -1095,68 +1163,95 @@ void CDebugerImpl::printError(Acad::ErrorStatus es, const AcString& prefex)
     {
       msg.format(L"\n\tprefex(%d): %s", prefex.constPtr(), es, strOut.constPtr());
     }
-    printInfo(msg);
+    printInfo(msg, kError);
   }
 }
 
 void CDebugerImpl::failure_eq(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line)
 {
-
+  reportCheck(L"==", m1, m2, file, line);
 }
 
 void CDebugerImpl::failure_ne(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line)
 {
-
+  reportCheck(L"!=", m1, m2, file, line);
 }
 
 void CDebugerImpl::failure_le(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line)
 {
-
+  reportCheck(L"<=", m1, m2, file, line);
 }
 
 void CDebugerImpl::failure_lt(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line)
 {
-
+  reportCheck(L"<", m1, m2, file, line);
 }
 
 void CDebugerImpl::failure_ge(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line)
 {
-
+  reportCheck(L">=", m1, m2, file, line);
 }
 
 void CDebugerImpl::failure_gt(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line)
 {
-
+  reportCheck(L">", m1, m2, file, line);
 }
 
 void CDebugerImpl::assert_eq(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line)
 {
-
+  reportCheck(L"==", m1, m2, file, line);
 }
 
 void CDebugerImpl::assert_ne(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line)
 {
-
+  reportCheck(L"!=", m1, m2, file, line);
 }
 
 void CDebugerImpl::assert_le(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line)
 {
-
+  reportCheck(L"<=", m1, m2, file, line);
 }
 
 void CDebugerImpl::assert_lt(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line)
 {
-
+  reportCheck(L"<", m1, m2, file, line);
 }
 
 void CDebugerImpl::assert_ge(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line)
 {
-
+  reportCheck(L">=", m1, m2, file, line);
 }
 
 void CDebugerImpl::assert_gt(const ACHAR* m1, const ACHAR* m2, const ACHAR* file, const ACHAR* line)
 {
+  reportCheck(L">", m1, m2, file, line);
+}
 
+void CDebugerImpl::metric(const ACHAR* name, double value)
+{
+  if (!name || !*name)
+  {
+    return;
+  }
+
+  CLogStream& stream = CLogStream::instance();
+  if (!stream.isAttached())
+  {
+    acutPrintf(L"\n%s = %g", name, value);
+    return;
+  }
+
+  uint32_t length = (uint32_t)wcslen(name);
+  std::vector<uint8_t> buf(64 + textSize(length));
+  CFrameWriter writer(buf.data(), buf.size());
+  writer.metric((const char16_t*)name, length, value);
+  stream.flush();
+  stream.send(writer.data(), (DWORD)writer.size(), kSendTimeout);
+}
+
+void CDebugerImpl::progress(unsigned int steps)
+{
+  CHeartbeat::instance().progress(steps);
 }
 
 AcDbObjectId CDbHelperImpl::addToModelSpace(AcDbEntity* pEntity)
@@ -1177,3 +1272,18 @@ AcDbObjectId CDbHelperImpl::addToModelSpace(AcDbEntity* pEntity)
 
   return objId;
 }
+
+void* CArtifactsImpl::create(const ACHAR* name, size_t size)
+{
+  return CArtifactStore::instance().create(name, size);
+}
+
+bool CArtifactsImpl::commit(void* data, size_t size)
+{
+  return CArtifactStore::instance().commit(data, size);
+}
+
+void CArtifactsImpl::discard(void* data)
+{
+  CArtifactStore::instance().discard(data);
+}
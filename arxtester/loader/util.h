@@ -3,6 +3,7 @@
 
 class CDebugerImpl;
 class CDbHelperImpl;
+class CArtifactsImpl;
 
 class CGlobalUtilImpl
   : public AcRxObject
@@ -10,9 +11,15 @@ class CGlobalUtilImpl
 {
   std::unique_ptr<CDebugerImpl> m_debuger;
   std::unique_ptr<CDbHelperImpl> m_dbHelper;
+  std::unique_ptr<CArtifactsImpl> m_artifacts;
 public:
   CGlobalUtilImpl();
 
   virtual CDebuger* debuger() const;
   virtual CDbHelper* dbHelper() const;
+  virtual CArtifacts* artifacts() const;
 };
+
+// The number of failed CDebuger checks since the last call; the loader
+// fails a case that has any.
+unsigned int takeCheckFailures();
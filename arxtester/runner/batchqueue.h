@@ -0,0 +1,81 @@
+#ifndef BATCHQUEUE_H
+#define BATCHQUEUE_H
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+// Unbounded lock-free queue for handing items from worker threads to one
+// consumer that takes them in batches. push() links a node onto a stack
+// with a single compare-exchange; take() detaches the whole stack with
+// one exchange and restores the push order. Producers never wait for the
+// consumer, so a busy UI thread cannot stall a run.
+template <class T>
+class CBatchQueue
+{
+public:
+  CBatchQueue()
+    : m_head(nullptr)
+  {
+  }
+
+  ~CBatchQueue()
+  {
+    std::vector<T> rest;
+    take(rest);
+  }
+
+  CBatchQueue(const CBatchQueue&) = delete;
+  CBatchQueue& operator=(const CBatchQueue&) = delete;
+
+  void push(T item)
+  {
+    Node* node = new Node(std::move(item));
+    node->next = m_head.load(std::memory_order_relaxed);
+    while (!m_head.compare_exchange_weak(node->next, node,
+      std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  // Appends everything pushed so far to items, oldest first. Returns
+  // false when there was nothing.
+  bool take(std::vector<T>& items)
+  {
+    Node* node = m_head.exchange(nullptr, std::memory_order_acquire);
+    if (!node)
+    {
+      return false;
+    }
+
+    // The stack is newest first.
+    Node* prev = nullptr;
+    while (node)
+    {
+      Node* next = node->next;
+      node->next = prev;
+      prev = node;
+      node = next;
+    }
+    for (node = prev; node; )
+    {
+      Node* next = node->next;
+      items.emplace_back(std::move(node->item));
+      delete node;
+      node = next;
+    }
+    return true;
+  }
+
+private:
+  struct Node
+  {
+    explicit Node(T&& value) : item(std::move(value)), next(nullptr) {}
+
+    T item;
+    Node* next;
+  };
+  std::atomic<Node*> m_head;
+};
+
+#endif//BATCHQUEUE_H
@@ -0,0 +1,82 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// Budget of a bench case: fakehost hangs must not wait out the default.
+static const uint32_t kBenchTimeout = 2000;
+
+// Every bench case weighs the same, and nothing is recorded.
+class CBenchHistory : public ICaseHistory
+{
+public:
+  virtual uint32_t estimate(const std::wstring&) const
+  {
+    return 1;
+  }
+
+  virtual uint32_t percentile(const std::wstring&, int) const
+  {
+    return 0;
+  }
+
+  virtual void record(const std::wstring&, uint32_t)
+  {
+  }
+};
+
+class CBenchSink : public IHostPoolSink
+{
+public:
+  explicit CBenchSink(BenchResult& result)
+    : m_result(result)
+  {
+  }
+
+  virtual void onCaseArtifact(int, const std::wstring&, const void*, uint64_t size)
+  {
+    m_result.artifacts++;
+    m_result.artifactBytes += size;
+  }
+
+  virtual void onCaseResult(int, CaseResult result, uint32_t ms)
+  {
+    m_result.counts[result]++;
+    m_result.caseMs += ms;
+  }
+
+private:
+  BenchResult& m_result;
+};
+
+BenchResult runBenchPool(const std::wstring& hostCmd, const std::wstring& session,
+  int cases, HostPoolOptions options, LoopHandle cancel)
+{
+  BenchResult result;
+  memset(&result, 0, sizeof(result));
+  if (!options.timeout)
+  {
+    options.timeout = kBenchTimeout;
+  }
+
+  std::vector<std::wstring> keys;
+  for (int i = 0; i < cases; i++)
+  {
+    wchar_t key[32];
+    swprintf(key, 32, L"fakehost:%06d", i);
+    keys.emplace_back(key);
+  }
+
+  CBenchHistory history;
+  CBenchSink sink(result);
+  auto start = std::chrono::steady_clock::now();
+  CHostPool pool(hostCmd, session, options, cancel);
+  result.bFinished = pool.run(keys, history, &sink);
+  auto end = std::chrono::steady_clock::now();
+
+  result.wallMs = std::chrono::duration<double, std::milli>(end - start).count();
+  result.workers = (std::max)((std::min)(options.workers, cases), 1);
+  result.launches = pool.launches();
+  return result;
+}
@@ -0,0 +1,27 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "hostpool.h"
+
+struct BenchResult
+{
+  bool bFinished;
+  int workers;
+  int launches;
+  double wallMs;
+  // The summed wall time of the cases, as the hosts reported it.
+  uint64_t caseMs;
+  int counts[kCaseTimeout + 1];
+  // Artifacts received, and their bytes.
+  int artifacts;
+  uint64_t artifactBytes;
+};
+
+// Runs `cases` synthetic cases, keyed "fakehost:<n>", on hostCmd through a
+// pool set up with options, and times the run. Every case weighs the same
+// and nothing is recorded. Shared by runner.exe /bench and the standalone
+// bench next to fakehost.
+BenchResult runBenchPool(const std::wstring& hostCmd, const std::wstring& session,
+  int cases, HostPoolOptions options, LoopHandle cancel);
+
+#endif//BENCH_H
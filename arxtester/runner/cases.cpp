@@ -53,6 +53,7 @@ void CArxCases::listModule(const wchar_t* path)
       if (am)
       {
         m_modules.emplace_back(am);
+        m_hashes.emplace_back(fileHash(path));
         hArx = nullptr;
       }
     }
@@ -69,3 +70,8 @@ IArxModule* CArxCases::moduleAt(int i) const
 {
   return m_modules.at(i);
 }
+
+const CString& CArxCases::moduleHash(int i) const
+{
+  return m_hashes.at(i);
+}
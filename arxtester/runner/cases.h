@@ -3,6 +3,7 @@
 class CArxCases : public IArxCases
 {
   std::vector<IArxModule*> m_modules;
+  std::vector<CString> m_hashes;
 public:
   CArxCases();
   virtual ~CArxCases();
@@ -10,6 +11,9 @@ public:
   virtual int moduleCount() const;
   virtual IArxModule* moduleAt(int i) const;
 
+  // Content hash of the module DLL, see fileHash().
+  const CString& moduleHash(int i) const;
+
 private:
   void listModule(const wchar_t* path);
 };
@@ -4,15 +4,25 @@
 
 typedef std::set<std::wstring> StringArray;
 
-CConfig::CConfig()
-  : m_bSave(false)
+CConfig::CConfig(const CString& file)
+  : m_file(file.IsEmpty() ? appDir() + L"config.xml" : file)
+  , m_bSave(false)
   , m_iSave(0)
   , m_iGcad(1)
+  , m_iWorkers(1)
+  , m_iBatch(1)
+  , m_iStandby(0)
+  , m_iTimeout(0)
+  , m_iTimeoutMargin(30000)
+  , m_iStartupTimeout(120000)
+  , m_iStallTimeout(0)
+  , m_iIncremental(1)
+  , m_iMinidump(0)
 {
   CoInitialize(nullptr);
 
   CXmlUtilDocReader* reader = xmlutilCreateXMLDocReader();
-  if (reader->Load(appDir() + L"config.xml"))
+  if (reader->Load(m_file))
   {
     CXmlUtilNode* root = reader->Root();
     if (root && root->Name() == L"Config")
@@ -93,6 +103,74 @@ CConfig::CConfig()
       {
         m_iGcad = nodeGcad->Value() == L"0" ? 0 : 1;
       }
+
+      CXmlUtilNode* nodeWorkers = root->Child(L"Workers");
+      if (nodeWorkers)
+      {
+        m_iWorkers = (std::max)(_wtoi(nodeWorkers->Value().c_str()), 1);
+      }
+
+      CXmlUtilNode* nodeBatch = root->Child(L"Batch");
+      if (nodeBatch)
+      {
+        m_iBatch = (std::max)(_wtoi(nodeBatch->Value().c_str()), 1);
+      }
+
+      CXmlUtilNode* nodeStandby = root->Child(L"Standby");
+      if (nodeStandby)
+      {
+        m_iStandby = (std::max)(_wtoi(nodeStandby->Value().c_str()), 0);
+      }
+
+      CXmlUtilNode* nodeTimeout = root->Child(L"Timeout");
+      if (nodeTimeout)
+      {
+        m_iTimeout = (std::max)(_wtoi(nodeTimeout->Value().c_str()), 0);
+      }
+
+      CXmlUtilNode* nodeTimeoutMargin = root->Child(L"TimeoutMargin");
+      if (nodeTimeoutMargin)
+      {
+        m_iTimeoutMargin = (std::max)(_wtoi(nodeTimeoutMargin->Value().c_str()), 0);
+      }
+
+      CXmlUtilNode* nodeStartupTimeout = root->Child(L"StartupTimeout");
+      if (nodeStartupTimeout)
+      {
+        m_iStartupTimeout = (std::max)(_wtoi(nodeStartupTimeout->Value().c_str()), 0);
+      }
+
+      CXmlUtilNode* nodeStallTimeout = root->Child(L"StallTimeout");
+      if (nodeStallTimeout)
+      {
+        m_iStallTimeout = (std::max)(_wtoi(nodeStallTimeout->Value().c_str()), 0);
+      }
+
+      CXmlUtilNode* nodeIncremental = root->Child(L"Incremental");
+      if (nodeIncremental)
+      {
+        m_iIncremental = nodeIncremental->Value() == L"0" ? 0 : 1;
+      }
+
+      CXmlUtilNode* nodeMinidump = root->Child(L"Minidump");
+      if (nodeMinidump)
+      {
+        m_iMinidump = nodeMinidump->Value() == L"1" ? 1 : 0;
+      }
+
+      CXmlUtilNode* nodeTimeouts = root->Child(L"Timeouts");
+      if (nodeTimeouts)
+      {
+        for (int i = 0; i < nodeTimeouts->ChildCount(); i++)
+        {
+          CXmlUtilNode* nodeCase = nodeTimeouts->Child(i);
+          if (nodeCase->Name() == L"Case" && nodeCase->Attribute(L"Name"))
+          {
+            m_timeouts[nodeCase->Attribute(L"Name")->Value()] =
+              (DWORD)wcstoul(nodeCase->Value().c_str(), nullptr, 10);
+          }
+        }
+      }
     }
   }
   reader->Release();
@@ -162,8 +240,61 @@ CConfig::~CConfig()
     CXmlUtilNode* nodeGcad = root->CreateChild(L"Gcad");
     nodeGcad->SetValue(m_iGcad ? L"1" : L"0");
 
-    writer->Save(appDir() + L"config.xml");
+    CXmlUtilNode* nodeWorkers = root->CreateChild(L"Workers");
+    nodeWorkers->SetValue(std::to_wstring(m_iWorkers).c_str());
+
+    CXmlUtilNode* nodeBatch = root->CreateChild(L"Batch");
+    nodeBatch->SetValue(std::to_wstring(m_iBatch).c_str());
+
+    CXmlUtilNode* nodeStandby = root->CreateChild(L"Standby");
+    nodeStandby->SetValue(std::to_wstring(m_iStandby).c_str());
+
+    CXmlUtilNode* nodeTimeout = root->CreateChild(L"Timeout");
+    nodeTimeout->SetValue(std::to_wstring(m_iTimeout).c_str());
+
+    CXmlUtilNode* nodeTimeoutMargin = root->CreateChild(L"TimeoutMargin");
+    nodeTimeoutMargin->SetValue(std::to_wstring(m_iTimeoutMargin).c_str());
+
+    CXmlUtilNode* nodeStartupTimeout = root->CreateChild(L"StartupTimeout");
+    nodeStartupTimeout->SetValue(std::to_wstring(m_iStartupTimeout).c_str());
+
+    CXmlUtilNode* nodeStallTimeout = root->CreateChild(L"StallTimeout");
+    nodeStallTimeout->SetValue(std::to_wstring(m_iStallTimeout).c_str());
+
+    CXmlUtilNode* nodeIncremental = root->CreateChild(L"Incremental");
+    nodeIncremental->SetValue(m_iIncremental ? L"1" : L"0");
+
+    CXmlUtilNode* nodeMinidump = root->CreateChild(L"Minidump");
+    nodeMinidump->SetValue(m_iMinidump ? L"1" : L"0");
+
+    if (!m_timeouts.empty())
+    {
+      CXmlUtilNode* nodeTimeouts = root->CreateChild(L"Timeouts");
+      for (auto& it : m_timeouts)
+      {
+        CXmlUtilNode* nodeCase = nodeTimeouts->CreateChild(L"Case");
+        nodeCase->AddAttribute(L"Name", it.first.c_str());
+        nodeCase->SetValue(std::to_wstring(it.second).c_str());
+      }
+    }
+
+    writer->Save(m_file);
     writer->Release();
     CoUninitialize();
   }
 }
+
+HostPoolOptions CConfig::poolOptions() const
+{
+  HostPoolOptions options;
+  options.workers = m_iWorkers;
+  options.batch = m_iBatch;
+  options.standby = m_iStandby;
+  options.timeout = (uint32_t)m_iTimeout;
+  options.timeoutMargin = (uint32_t)m_iTimeoutMargin;
+  options.startupTimeout = (uint32_t)m_iStartupTimeout;
+  options.stallTimeout = (uint32_t)m_iStallTimeout;
+  options.bMinidump = m_iMinidump != 0;
+  options.timeouts.insert(m_timeouts.begin(), m_timeouts.end());
+  return options;
+}
@@ -1,18 +1,39 @@
 ﻿#pragma once
 
 #include "cases.h"
+#include "hostpool.h"
 
 class CConfig
 {
 public:
-  CConfig();
+  // Loads config.xml next to the runner, or the given suite file, which
+  // uses the same format.
+  CConfig(const CString& file = CString());
   ~CConfig();
 
+  // The pool settings of this config.
+  HostPoolOptions poolOptions() const;
+
 public:
+  CString m_file;
   bool m_bSave;
   CString m_logPath;
   CArxCases m_ac;
   CStringArray m_filters;
   int m_iSave;
   int m_iGcad;
+  int m_iWorkers;
+  int m_iBatch;
+  int m_iStandby;
+  int m_iTimeout;
+  int m_iTimeoutMargin;
+  int m_iStartupTimeout;
+  // <StallTimeout> ms, 0 (the default) for off. The host's heartbeat only
+  // advances while it pumps messages or a case calls CDebuger::progress(),
+  // so a suite that turns this on needs its long computing cases to call
+  // progress() more often than that.
+  int m_iStallTimeout;
+  int m_iIncremental;
+  int m_iMinidump;
+  std::map<std::wstring, DWORD> m_timeouts;
 };
@@ -0,0 +1,120 @@
+#include "eventloop.h"
+
+#include <chrono>
+#include <climits>
+
+CEventLoop::CEventLoop()
+  : m_nextTimer(1)
+  , m_bStopped(false)
+{
+}
+
+CEventLoop::~CEventLoop()
+{
+}
+
+uint64_t CEventLoop::now()
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CEventLoop::TimerId CEventLoop::addTimer(uint64_t ms, Callback cb)
+{
+  TimerId id = m_nextTimer++;
+  auto it = m_timers.emplace(now() + ms, Timer{ id, std::move(cb) });
+  m_timerIds.emplace(id, it);
+  return id;
+}
+
+void CEventLoop::cancelTimer(TimerId id)
+{
+  auto it = m_timerIds.find(id);
+  if (it != m_timerIds.end())
+  {
+    m_timers.erase(it->second);
+    m_timerIds.erase(it);
+  }
+}
+
+void CEventLoop::post(Callback cb)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_posted.emplace_back(std::move(cb));
+  }
+  wake();
+}
+
+void CEventLoop::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_bStopped = true;
+  }
+  wake();
+}
+
+void CEventLoop::run()
+{
+  for (;;)
+  {
+    runPosted();
+    runTimers();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_bStopped)
+      {
+        m_bStopped = false;
+        break;
+      }
+      if (!m_posted.empty())
+      {
+        continue;
+      }
+    }
+    poll(nextTimeout());
+  }
+}
+
+int CEventLoop::nextTimeout() const
+{
+  if (m_timers.empty())
+  {
+    return -1;
+  }
+
+  uint64_t current = now();
+  uint64_t deadline = m_timers.begin()->first;
+  if (deadline <= current)
+  {
+    return 0;
+  }
+  uint64_t wait = deadline - current;
+  return wait > INT_MAX ? INT_MAX : (int)wait;
+}
+
+void CEventLoop::runTimers()
+{
+  uint64_t current = now();
+  while (!m_timers.empty() && m_timers.begin()->first <= current)
+  {
+    Timer timer = std::move(m_timers.begin()->second);
+    m_timerIds.erase(timer.id);
+    m_timers.erase(m_timers.begin());
+    timer.cb();
+  }
+}
+
+void CEventLoop::runPosted()
+{
+  std::vector<Callback> posted;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    posted.swap(m_posted);
+  }
+  for (auto& it : posted)
+  {
+    it();
+  }
+}
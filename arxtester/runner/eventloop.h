@@ -0,0 +1,76 @@
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+typedef void* LoopHandle;   // any waitable HANDLE: process, event, ...
+#else
+typedef int LoopHandle;     // any pollable fd: eventfd, pidfd, pipe, ...
+#endif
+
+// Single-threaded supervisor loop multiplexing waitable handles, timers
+// and callbacks posted from other threads. Only post() and stop() may be
+// called from another thread; everything else belongs to the thread that
+// calls run().
+class CEventLoop
+{
+public:
+  typedef std::function<void()> Callback;
+  typedef uint64_t TimerId;
+
+  static std::unique_ptr<CEventLoop> create();
+  virtual ~CEventLoop();
+
+  // Calls cb once, on the loop thread, when h becomes signalled. Call
+  // watch() again from cb to keep waiting on the same handle.
+  virtual void watch(LoopHandle h, Callback cb) = 0;
+  virtual void unwatch(LoopHandle h) = 0;
+
+  // One-shot timer.
+  TimerId addTimer(uint64_t ms, Callback cb);
+  void cancelTimer(TimerId id);
+
+  void post(Callback cb);
+
+  // Runs until stop() is called.
+  void run();
+  void stop();
+
+  static uint64_t now();
+
+protected:
+  CEventLoop();
+
+  // Blocks for at most timeoutMs (-1: forever) and dispatches the
+  // handles that got signalled in the meantime.
+  virtual void poll(int timeoutMs) = 0;
+  // Makes a concurrent poll() return.
+  virtual void wake() = 0;
+
+private:
+  int nextTimeout() const;
+  void runTimers();
+  void runPosted();
+
+private:
+  struct Timer
+  {
+    TimerId id;
+    Callback cb;
+  };
+  std::multimap<uint64_t, Timer> m_timers;
+  std::map<TimerId, std::multimap<uint64_t, Timer>::iterator> m_timerIds;
+  TimerId m_nextTimer;
+
+  std::mutex m_mutex;
+  std::vector<Callback> m_posted;
+  bool m_bStopped;
+};
+
+#endif//EVENTLOOP_H
@@ -0,0 +1,98 @@
+#ifdef __linux__
+
+#include "eventloop.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// Watches are one-shot epoll registrations; an eventfd wakes the loop for
+// posted callbacks and stop().
+class CEventLoopEpoll : public CEventLoop
+{
+public:
+  CEventLoopEpoll()
+    : m_epoll(epoll_create1(EPOLL_CLOEXEC))
+    , m_wake(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+  {
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = m_wake;
+    epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &ev);
+  }
+
+  virtual ~CEventLoopEpoll()
+  {
+    close(m_wake);
+    close(m_epoll);
+  }
+
+  virtual void watch(LoopHandle fd, Callback cb)
+  {
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.fd = fd;
+    bool bExists = m_watches.find(fd) != m_watches.end();
+    if (epoll_ctl(m_epoll, bExists ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) == 0)
+    {
+      m_watches[fd] = std::move(cb);
+    }
+  }
+
+  virtual void unwatch(LoopHandle fd)
+  {
+    if (m_watches.erase(fd))
+    {
+      epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    }
+  }
+
+protected:
+  virtual void poll(int timeoutMs)
+  {
+    epoll_event events[64];
+    int count = epoll_wait(m_epoll, events, 64, timeoutMs);
+    for (int i = 0; i < count; i++)
+    {
+      int fd = events[i].data.fd;
+      if (fd == m_wake)
+      {
+        uint64_t value = 0;
+        ssize_t ret = read(m_wake, &value, sizeof(value));
+        (void)ret;
+        continue;
+      }
+
+      // A callback earlier in this round may have unwatched it.
+      auto it = m_watches.find(fd);
+      if (it == m_watches.end())
+      {
+        continue;
+      }
+
+      Callback cb = std::move(it->second);
+      m_watches.erase(it);
+      epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+      cb();
+    }
+  }
+
+  virtual void wake()
+  {
+    uint64_t one = 1;
+    ssize_t ret = write(m_wake, &one, sizeof(one));
+    (void)ret;
+  }
+
+private:
+  int m_epoll;
+  int m_wake;
+  std::map<int, Callback> m_watches;
+};
+
+std::unique_ptr<CEventLoop> CEventLoop::create()
+{
+  return std::make_unique<CEventLoopEpoll>();
+}
+
+#endif//__linux__
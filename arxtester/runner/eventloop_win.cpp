@@ -0,0 +1,124 @@
+#ifdef _WIN32
+
+#include "eventloop.h"
+
+#include <windows.h>
+
+// Waits are registered with the system thread pool; when one fires its
+// callback posts the wait id to a completion port, which the loop thread
+// drains. This avoids the 64 handle limit of WaitForMultipleObjects.
+class CEventLoopWin : public CEventLoop
+{
+  struct Wait
+  {
+    HANDLE hPort;
+    ULONG_PTR id;
+    HANDLE hWait;
+    LoopHandle handle;
+    Callback cb;
+  };
+
+public:
+  CEventLoopWin()
+    : m_hPort(CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1))
+    , m_nextWait(1)
+  {
+  }
+
+  virtual ~CEventLoopWin()
+  {
+    for (auto& it : m_waits)
+    {
+      UnregisterWaitEx(it.second->hWait, INVALID_HANDLE_VALUE);
+    }
+    CloseHandle(m_hPort);
+  }
+
+  virtual void watch(LoopHandle h, Callback cb)
+  {
+    unwatch(h);
+
+    std::unique_ptr<Wait> wait(new Wait{ m_hPort, m_nextWait++, nullptr, h, std::move(cb) });
+    if (RegisterWaitForSingleObject(&wait->hWait, h, waitCallback, wait.get(),
+      INFINITE, WT_EXECUTEONLYONCE))
+    {
+      m_byHandle[h] = wait->id;
+      m_waits[wait->id] = std::move(wait);
+    }
+  }
+
+  virtual void unwatch(LoopHandle h)
+  {
+    auto it = m_byHandle.find(h);
+    if (it == m_byHandle.end())
+    {
+      return;
+    }
+
+    auto wait = m_waits.find(it->second);
+    // Blocks until a callback in flight has finished with the Wait; a
+    // completion it already queued is ignored by poll().
+    UnregisterWaitEx(wait->second->hWait, INVALID_HANDLE_VALUE);
+    m_waits.erase(wait);
+    m_byHandle.erase(it);
+  }
+
+protected:
+  virtual void poll(int timeoutMs)
+  {
+    DWORD timeout = timeoutMs < 0 ? INFINITE : (DWORD)timeoutMs;
+    DWORD bytes = 0;
+    ULONG_PTR key = 0;
+    LPOVERLAPPED ov = nullptr;
+    while (GetQueuedCompletionStatus(m_hPort, &bytes, &key, &ov, timeout))
+    {
+      if (key)
+      {
+        fire(key);
+      }
+      timeout = 0;
+    }
+  }
+
+  virtual void wake()
+  {
+    PostQueuedCompletionStatus(m_hPort, 0, 0, nullptr);
+  }
+
+private:
+  static VOID CALLBACK waitCallback(PVOID param, BOOLEAN)
+  {
+    Wait* wait = (Wait*)param;
+    PostQueuedCompletionStatus(wait->hPort, 0, wait->id, nullptr);
+  }
+
+  void fire(ULONG_PTR id)
+  {
+    auto it = m_waits.find(id);
+    if (it == m_waits.end())
+    {
+      return;
+    }
+
+    std::unique_ptr<Wait> wait = std::move(it->second);
+    m_waits.erase(it);
+    m_byHandle.erase(wait->handle);
+    // One-shot waits still have to be unregistered; the callback has
+    // already run, so this does not block.
+    UnregisterWaitEx(wait->hWait, nullptr);
+    wait->cb();
+  }
+
+private:
+  HANDLE m_hPort;
+  ULONG_PTR m_nextWait;
+  std::map<ULONG_PTR, std::unique_ptr<Wait>> m_waits;
+  std::map<LoopHandle, ULONG_PTR> m_byHandle;
+};
+
+std::unique_ptr<CEventLoop> CEventLoop::create()
+{
+  return std::make_unique<CEventLoopWin>();
+}
+
+#endif//_WIN32
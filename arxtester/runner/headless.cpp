@@ -0,0 +1,186 @@
+#include "pch.h"
+#include "suite.h"
+#include "config.h"
+#include "bench.h"
+#include "headless.h"
+
+static HANDLE g_hCancel = nullptr;
+
+static BOOL WINAPI ctrlHandler(DWORD)
+{
+  SetEvent(g_hCancel);
+  return TRUE;
+}
+
+// runner.exe is a windows application: it only has a stdout when it is
+// redirected, otherwise borrow the console of the parent.
+static HANDLE openConsole()
+{
+  HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+  if (hOut == nullptr || hOut == INVALID_HANDLE_VALUE)
+  {
+    hOut = nullptr;
+    if (AttachConsole(ATTACH_PARENT_PROCESS))
+    {
+      hOut = CreateFile(L"CONOUT$", GENERIC_WRITE, FILE_SHARE_WRITE,
+        nullptr, OPEN_EXISTING, 0, nullptr);
+    }
+  }
+  return hOut;
+}
+
+static void printLine(HANDLE hOut, const CString& line)
+{
+  if (hOut && hOut != INVALID_HANDLE_VALUE)
+  {
+    CStringA utf8 = CW2A(line + L"\n", CP_UTF8);
+    DWORD written = 0;
+    WriteFile(hOut, (LPCSTR)utf8, utf8.GetLength(), &written, nullptr);
+  }
+}
+
+class CConsoleSink : public ISuiteSink
+{
+public:
+  CConsoleSink(const CSuite& suite)
+    : m_suite(suite)
+    , m_hOut(openConsole())
+    , m_nCases(0)
+  {
+    memset(m_counts, 0, sizeof(m_counts));
+  }
+
+  virtual void onCase(int, const CString&)
+  {
+    m_nCases++;
+  }
+
+  virtual void onCaseResult(int index, CaseResult result, uint32_t ms)
+  {
+    CString line;
+    line.Format(L"%s\t%u\t%s", resultName(result), ms, (LPCTSTR)m_suite.caseKey(index));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_counts[result]++;
+    print(line);
+  }
+
+  void print(const CString& line)
+  {
+    printLine(m_hOut, line);
+  }
+
+  int exitCode(bool bFinished) const
+  {
+    if (!bFinished)
+    {
+      return kExitCancelled;
+    }
+    if (m_nCases == 0)
+    {
+      return kExitNoCases;
+    }
+    if (m_counts[kCaseCrash] || m_counts[kCaseTimeout] || m_counts[kCaseError])
+    {
+      return kExitCrashes;
+    }
+    if (m_counts[kCaseFail])
+    {
+      return kExitFailures;
+    }
+    return kExitSuccess;
+  }
+
+private:
+  const CSuite& m_suite;
+  HANDLE m_hOut;
+  std::mutex m_mutex;
+  int m_nCases;
+  int m_counts[kCaseTimeout + 1];
+};
+
+int runHeadless(const CString& suiteFile, const CString& resultFile,
+  int shard, int shards, const CString& weightsFile, bool bFull, bool bResume)
+{
+  CSuite suite;
+  suite.setSuiteFile(suiteFile);
+  if (!suite.setShard(shard, shards, weightsFile))
+  {
+    return failHeadless(L"cannot read " + weightsFile);
+  }
+  suite.setFull(bFull);
+  suite.setResume(bResume);
+  if (resultFile.IsEmpty())
+  {
+    suite.newResultFile();
+  }
+  else
+  {
+    suite.setResultFile(resultFile);
+  }
+
+  CConsoleSink sink(suite);
+
+  g_hCancel = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+  SetConsoleCtrlHandler(ctrlHandler, TRUE);
+
+  bool bFinished = suite.run(g_hCancel, &sink);
+
+  SetConsoleCtrlHandler(ctrlHandler, FALSE);
+  CloseHandle(g_hCancel);
+  g_hCancel = nullptr;
+
+  sink.print(L"# " + suite.resultFile());
+  return sink.exitCode(bFinished);
+}
+
+int failHeadless(const CString& error)
+{
+  printLine(openConsole(), L"# error: " + error);
+  return kExitError;
+}
+
+int runBench(int cases, const CString& hostArgs)
+{
+  CString cmdLine;
+  cmdLine.Format(L"\"%sfakehost.exe\" %s", (LPCTSTR)appDir(), (LPCTSTR)hostArgs);
+
+  HANDLE hOut = openConsole();
+  g_hCancel = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+  SetConsoleCtrlHandler(ctrlHandler, TRUE);
+
+  BenchResult result = runBenchPool((LPCTSTR)cmdLine, (LPCTSTR)newSessionId(), cases,
+    CConfig().poolOptions(), g_hCancel);
+
+  SetConsoleCtrlHandler(ctrlHandler, FALSE);
+  CloseHandle(g_hCancel);
+  g_hCancel = nullptr;
+
+  // Overhead is the worker time not spent inside cases: launches, the
+  // channel round trips, scheduling and the wait for hung hosts.
+  double overhead = cases ?
+    (result.wallMs * result.workers - result.caseMs) / cases : 0;
+
+  CString line;
+  line.Format(L"# %s: %d cases, %d workers, %d hosts, %.3f s",
+    result.bFinished ? L"finished" : L"cancelled", cases, result.workers, result.launches,
+    result.wallMs / 1000);
+  printLine(hOut, line);
+  line = L"#";
+  for (int i = kCaseSuccess; i <= kCaseTimeout; i++)
+  {
+    CString count;
+    count.Format(L" %s %d", resultName((CaseResult)i), result.counts[i]);
+    line += count;
+  }
+  printLine(hOut, line);
+  line.Format(L"# %.1f cases/s, %.3f ms overhead per case",
+    result.wallMs > 0 ? cases * 1000 / result.wallMs : 0, overhead);
+  printLine(hOut, line);
+  if (result.artifacts)
+  {
+    line.Format(L"# %d artifacts, %I64u bytes", result.artifacts, result.artifactBytes);
+    printLine(hOut, line);
+  }
+  return result.bFinished ? kExitSuccess : kExitCancelled;
+}
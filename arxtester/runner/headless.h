@@ -0,0 +1,29 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+// Process exit codes of a headless run.
+enum HeadlessExitCode
+{
+  kExitSuccess = 0,   // every case passed
+  kExitFailures = 1,  // at least one case failed
+  kExitCrashes = 2,   // at least one case crashed, timed out or could not start
+  kExitCancelled = 3, // the run was interrupted
+  kExitNoCases = 4,   // the suite selected nothing
+  kExitError = 5,     // bad arguments or unreadable/unwritable files
+};
+
+// Runs the suite without any window, streaming every result to stdout
+// and to the result file as soon as it arrives.
+int runHeadless(const CString& suiteFile, const CString& resultFile,
+  int shard, int shards, const CString& weightsFile, bool bFull, bool bResume);
+
+// Prints error, a problem with the arguments, the way a headless run
+// reports and returns kExitError.
+int failHeadless(const CString& error);
+
+// Runs `cases` synthetic cases on fakehost.exe, started with hostArgs,
+// through the configured host pool, and prints throughput and the runner
+// overhead per case. Nothing is recorded.
+int runBench(int cases, const CString& hostArgs);
+
+#endif//HEADLESS_H
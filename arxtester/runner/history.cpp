@@ -0,0 +1,234 @@
+#include "pch.h"
+#include "xmlutil.h"
+#include "results.h"
+#include "history.h"
+
+// Samples kept per case.
+static const size_t kMaxSamples = 32;
+// Estimate used before any case has a history at all.
+static const DWORD kDefaultEstimate = 10000;
+
+static DWORD mean(const std::deque<DWORD>& samples)
+{
+  if (samples.empty())
+  {
+    return 0;
+  }
+
+  ULONGLONG sum = 0;
+  for (auto& it : samples)
+  {
+    sum += it;
+  }
+  return (DWORD)(sum / samples.size());
+}
+
+CCaseHistory::CCaseHistory(const CString& file)
+  : m_file(file.IsEmpty() ? appDir() + L"history.xml" : file)
+  , m_bLoaded(false)
+{
+  m_bLoaded = load(m_cases);
+}
+
+bool CCaseHistory::isLoaded() const
+{
+  return m_bLoaded;
+}
+
+bool CCaseHistory::load(Cases& cases) const
+{
+  CoInitialize(nullptr);
+
+  CXmlUtilDocReader* reader = xmlutilCreateXMLDocReader();
+  bool bLoaded = reader->Load(m_file);
+  if (bLoaded)
+  {
+    CXmlUtilNode* root = reader->Root();
+    if (root && root->Name() == L"History")
+    {
+      for (int i = 0; i < root->ChildCount(); i++)
+      {
+        CXmlUtilNode* nodeCase = root->Child(i);
+        if (nodeCase->Name() != L"Case")
+        {
+          continue;
+        }
+
+        CXmlUtilNode* nodeName = nodeCase->Attribute(L"Name");
+        if (!nodeName)
+        {
+          continue;
+        }
+
+        Case& data = cases[nodeName->Value()];
+        CXmlUtilNode* nodeFingerprint = nodeCase->Attribute(L"Fingerprint");
+        CXmlUtilNode* nodeResult = nodeCase->Attribute(L"Result");
+        CXmlUtilNode* nodeMs = nodeCase->Attribute(L"Ms");
+        if (nodeFingerprint && nodeResult &&
+          parseResultName(nodeResult->Value().c_str(), data.result))
+        {
+          data.fingerprint = nodeFingerprint->Value();
+          data.ms = nodeMs ? (DWORD)wcstoul(nodeMs->Value().c_str(), nullptr, 10) : 0;
+        }
+
+        Samples& samples = data.samples;
+        for (int j = 0; j < nodeCase->ChildCount(); j++)
+        {
+          CXmlUtilNode* nodeTime = nodeCase->Child(j);
+          if (nodeTime->Name() == L"Time")
+          {
+            samples.emplace_back((DWORD)wcstoul(nodeTime->Value().c_str(), nullptr, 10));
+          }
+        }
+      }
+    }
+  }
+  reader->Release();
+
+  CoUninitialize();
+  return bLoaded;
+}
+
+void CCaseHistory::record(const std::wstring& key, uint32_t ms)
+{
+  Samples& samples = m_cases[key].samples;
+  samples.emplace_back(ms);
+  while (samples.size() > kMaxSamples)
+  {
+    samples.pop_front();
+  }
+  m_dirty.emplace(key);
+}
+
+bool CCaseHistory::isKnown(const CString& key) const
+{
+  auto it = m_cases.find((LPCTSTR)key);
+  return it != m_cases.end() && !it->second.samples.empty();
+}
+
+uint32_t CCaseHistory::estimate(const std::wstring& key) const
+{
+  auto it = m_cases.find(key);
+  if (it == m_cases.end() || it->second.samples.empty())
+  {
+    return fallback();
+  }
+  return mean(it->second.samples);
+}
+
+uint32_t CCaseHistory::percentile(const std::wstring& key, int p) const
+{
+  auto it = m_cases.find(key);
+  if (it == m_cases.end() || it->second.samples.empty())
+  {
+    return 0;
+  }
+
+  std::vector<DWORD> sorted(it->second.samples.begin(), it->second.samples.end());
+  std::sort(sorted.begin(), sorted.end());
+  size_t rank = (sorted.size() * p + 99) / 100;
+  return sorted[rank ? rank - 1 : 0];
+}
+
+DWORD CCaseHistory::fallback() const
+{
+  ULONGLONG sum = 0;
+  size_t count = 0;
+  for (auto& it : m_cases)
+  {
+    if (!it.second.samples.empty())
+    {
+      sum += mean(it.second.samples);
+      count++;
+    }
+  }
+  return count ? (DWORD)(sum / count) : kDefaultEstimate;
+}
+
+bool CCaseHistory::lastResult(const CString& key, const CString& fingerprint,
+  CaseResult& result, DWORD& ms) const
+{
+  auto it = m_cases.find((LPCTSTR)key);
+  if (it == m_cases.end() || it->second.fingerprint.empty() ||
+    it->second.fingerprint != (LPCTSTR)fingerprint)
+  {
+    return false;
+  }
+
+  result = it->second.result;
+  ms = it->second.ms;
+  return true;
+}
+
+void CCaseHistory::setLastResult(const CString& key, const CString& fingerprint,
+  CaseResult result, DWORD ms)
+{
+  Case& data = m_cases[(LPCTSTR)key];
+  data.fingerprint = fingerprint;
+  data.result = result;
+  data.ms = ms;
+  m_dirty.emplace((LPCTSTR)key);
+}
+
+void CCaseHistory::clearLastResult(const CString& key)
+{
+  auto it = m_cases.find((LPCTSTR)key);
+  if (it != m_cases.end() && !it->second.fingerprint.empty())
+  {
+    it->second.fingerprint.clear();
+    m_dirty.emplace(it->first);
+  }
+}
+
+bool CCaseHistory::save() const
+{
+  if (m_dirty.empty())
+  {
+    return true;
+  }
+
+  // Merge into what other runners saved since this one loaded.
+  HANDLE hLock = CreateMutex(nullptr, FALSE, L"Local\\ArxTester-History");
+  if (hLock)
+  {
+    WaitForSingleObject(hLock, INFINITE);
+  }
+  Cases cases;
+  load(cases);
+  for (auto& key : m_dirty)
+  {
+    cases[key] = m_cases.at(key);
+  }
+
+  CoInitialize(nullptr);
+
+  CXmlUtilDocWriter* writer = xmlutilCreateXMLDocWriter();
+  CXmlUtilNode* root = writer->CreateRoot(L"History");
+  for (auto& it : cases)
+  {
+    CXmlUtilNode* nodeCase = root->CreateChild(L"Case");
+    nodeCase->AddAttribute(L"Name", it.first.c_str());
+    if (!it.second.fingerprint.empty())
+    {
+      nodeCase->AddAttribute(L"Fingerprint", it.second.fingerprint.c_str());
+      nodeCase->AddAttribute(L"Result", resultName(it.second.result));
+      nodeCase->AddAttribute(L"Ms", std::to_wstring(it.second.ms).c_str());
+    }
+    for (auto& ms : it.second.samples)
+    {
+      CXmlUtilNode* nodeTime = nodeCase->CreateChild(L"Time");
+      nodeTime->SetValue(std::to_wstring(ms).c_str());
+    }
+  }
+
+  bool ret = writer->Save(m_file);
+  writer->Release();
+
+  CoUninitialize();
+  if (hLock)
+  {
+    ReleaseMutex(hLock);
+    CloseHandle(hLock);
+  }
+  return ret;
+}
@@ -0,0 +1,66 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "hostpool.h"
+
+// Wall times of the cases from previous runs, kept in history.xml next to
+// the runner. Cases are keyed by their "arx:case" dispatch string.
+//
+// Runners may share the file: save() rereads it under a machine-wide lock
+// and replaces only the cases this instance changed.
+class CCaseHistory : public ICaseHistory
+{
+public:
+  // Loads file, history.xml next to the runner by default.
+  CCaseHistory(const CString& file = CString());
+
+  // False when the file could not be read; the history is empty then.
+  bool isLoaded() const;
+
+  virtual void record(const std::wstring& key, uint32_t ms);
+  bool isKnown(const CString& key) const;
+
+  // Mean of the recorded samples. Cases that never ran are estimated with
+  // the mean of the known cases.
+  virtual uint32_t estimate(const std::wstring& key) const;
+
+  // The p-th percentile (0..100) of the recorded samples, 0 if unknown.
+  virtual uint32_t percentile(const std::wstring& key, int p) const;
+
+  // The last result of a case together with the fingerprint of the
+  // module and host it ran on. lastResult() fails when the fingerprint
+  // differs, so a cached result is only reused for identical binaries.
+  bool lastResult(const CString& key, const CString& fingerprint,
+    CaseResult& result, DWORD& ms) const;
+  void setLastResult(const CString& key, const CString& fingerprint,
+    CaseResult result, DWORD ms);
+  void clearLastResult(const CString& key);
+
+  bool save() const;
+
+private:
+  DWORD fallback() const;
+
+private:
+  typedef std::deque<DWORD> Samples;
+  struct Case
+  {
+    Case() : result(kCaseSuccess), ms(0) {}
+
+    Samples samples;
+    std::wstring fingerprint;
+    CaseResult result;
+    DWORD ms;
+  };
+  typedef std::map<std::wstring, Case> Cases;
+
+  bool load(Cases& cases) const;
+
+private:
+  CString m_file;
+  bool m_bLoaded;
+  Cases m_cases;
+  std::set<std::wstring> m_dirty;
+};
+
+#endif//HISTORY_H
@@ -0,0 +1,613 @@
+#include "../inc/arxcase.h"
+#include "sharefile.h"
+#include "eventloop.h"
+#include "ipc.h"
+#include "protocol.h"
+#include "status.h"
+#include "hostpool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cwctype>
+#include <deque>
+
+// Budget of a case that never ran and has no configured timeout.
+static const uint32_t kUnknownTimeout = 10 * 60 * 1000;
+// How often the heartbeat and progress of a busy host are sampled.
+static const uint32_t kStallCheck = 1000;
+
+// Frame text is UTF-16, and wchar_t is wider than that outside Windows.
+static std::u16string toText(const std::wstring& str)
+{
+  return std::u16string(str.begin(), str.end());
+}
+
+static std::wstring fromText(const FrameText& text)
+{
+  return std::wstring(text.data, text.data + text.length);
+}
+
+static std::wstring trim(const std::wstring& str)
+{
+  size_t begin = 0;
+  size_t end = str.length();
+  while (begin < end && iswspace(str[begin]))
+  {
+    begin++;
+  }
+  while (end > begin && iswspace(str[end - 1]))
+  {
+    end--;
+  }
+  return str.substr(begin, end - begin);
+}
+
+class CHost
+{
+public:
+  CHost(const std::wstring& name)
+    : channel(name)
+    , cases(channelCaseName(name.c_str()).c_str())
+    , results(channelResultName(name.c_str()).c_str())
+    , status(channelStatusName(name.c_str()).c_str())
+  {
+    start.create(channelStartName(name.c_str()).c_str(), true);
+    start.reset();
+  }
+
+  // Hosts are retired through the event loop; one still running here is
+  // left over from a cancelled run.
+  ~CHost()
+  {
+    process.kill();
+  }
+
+  std::wstring channel;
+  CIpcProcess process;
+  CIpcEvent start;
+  CShareFile cases;
+  CShareFile results;
+  CShareStatus status;
+};
+
+class CWorker
+{
+public:
+  CWorker()
+    : next(0)
+    , sent(0)
+    , bEnded(false)
+    , timer(0)
+    , watchdog(0)
+    , heartbeat(0)
+    , progress(0)
+    , heartbeatAt(0)
+    , progressAt(0)
+    , bReports(false)
+  {
+  }
+
+  std::vector<int> batch;
+  size_t next;
+  // Cases of the batch written to the host's queue, and whether the end
+  // of the queue was.
+  size_t sent;
+  bool bEnded;
+  std::unique_ptr<CHost> host;
+  std::deque<std::unique_ptr<CHost>> standby;
+  CEventLoop::TimerId timer;
+
+  // Last heartbeat and progress seen, when they last changed, and
+  // whether the running case reports progress at all.
+  CEventLoop::TimerId watchdog;
+  uint64_t heartbeat;
+  uint64_t progress;
+  uint64_t heartbeatAt;
+  uint64_t progressAt;
+  bool bReports;
+};
+
+CHostPool::CHostPool(const std::wstring& cmdLine, const std::wstring& session,
+  const HostPoolOptions& options, LoopHandle cancel)
+  : m_cmdLine(cmdLine)
+  , m_session(session)
+  , m_options(options)
+  , m_cancel(cancel)
+  , m_cases(nullptr)
+  , m_history(nullptr)
+  , m_sink(nullptr)
+  , m_active(0)
+  , m_frame(CShareFile::kDefaultCapacity)
+  , m_remaining(0)
+  , m_next(0)
+  , m_launches(0)
+  , m_bCancelled(false)
+{
+  m_options.workers = (std::max)(m_options.workers, 1);
+  m_options.batch = (std::max)(m_options.batch, 1);
+  m_options.standby = (std::max)(m_options.standby, 0);
+}
+
+CHostPool::~CHostPool()
+{
+}
+
+bool CHostPool::run(const std::vector<std::wstring>& cases, ICaseHistory& history,
+  IHostPoolSink* sink)
+{
+  m_cases = &cases;
+  m_history = &history;
+  m_sink = sink;
+  m_next = 0;
+  m_bCancelled = false;
+
+  m_remaining = 0;
+  m_estimates.resize(cases.size());
+  m_order.resize(cases.size());
+  for (size_t i = 0; i < cases.size(); i++)
+  {
+    m_estimates[i] = history.estimate(cases[i]);
+    m_remaining += m_estimates[i];
+    m_order[i] = i;
+  }
+  std::stable_sort(m_order.begin(), m_order.end(), [this](int a, int b)
+  {
+    return m_estimates[a] > m_estimates[b];
+  });
+
+  // Keys are "arx:case"; the queue entries carry the arx part and the
+  // case id, worked out once here.
+  m_budgets.resize(cases.size());
+  m_arxLengths.resize(cases.size());
+  m_ids.resize(cases.size());
+  for (size_t i = 0; i < cases.size(); i++)
+  {
+    const std::wstring& key = cases[i];
+    m_budgets[i] = budget(key);
+    size_t pos = key.find(L':');
+    std::wstring arx = key.substr(0, pos);
+    m_arxLengths[i] = (uint32_t)arx.length();
+    m_ids[i] = arxCaseId(arx.c_str(), pos == std::wstring::npos ? L"" : key.c_str() + pos + 1);
+  }
+
+  m_loop = CEventLoop::create();
+  m_loop->watch(m_cancel, [this]
+  {
+    m_bCancelled = true;
+    m_loop->stop();
+  });
+
+  m_active = (int)(std::min)((size_t)m_options.workers, cases.size());
+  for (int i = 0; i < m_active; i++)
+  {
+    m_workerList.emplace_back(std::make_unique<CWorker>());
+    CWorker* worker = m_workerList.back().get();
+    m_loop->post([this, worker] { dispatch(*worker); });
+  }
+  if (m_active)
+  {
+    m_loop->run();
+  }
+
+  // Drop the waits before the handles they refer to; on cancel the
+  // remaining hosts are killed by their destructors.
+  m_loop.reset();
+  m_workerList.clear();
+  m_retiring.clear();
+
+  return !m_bCancelled;
+}
+
+bool CHostPool::nextBatch(std::vector<int>& batch)
+{
+  batch.clear();
+  if (m_bCancelled)
+  {
+    return false;
+  }
+
+  // Never take more than a fair share of the estimated time left, so the
+  // batches shrink towards the end and the workers finish together.
+  uint64_t share = m_remaining / m_options.workers;
+  uint64_t taken = 0;
+  while (m_next < m_order.size() && (int)batch.size() < m_options.batch)
+  {
+    int index = m_order[m_next];
+    if (!batch.empty() && taken + m_estimates[index] > share)
+    {
+      break;
+    }
+
+    batch.emplace_back(index);
+    taken += m_estimates[index];
+    m_next++;
+  }
+  m_remaining -= (std::min)(taken, m_remaining);
+  return !batch.empty();
+}
+
+uint32_t CHostPool::budget(const std::wstring& key) const
+{
+  auto it = m_options.timeouts.find(key);
+  if (it != m_options.timeouts.end())
+  {
+    return it->second;
+  }
+  if (m_options.timeout)
+  {
+    return m_options.timeout;
+  }
+
+  uint32_t p99 = m_history->percentile(key, 99);
+  return p99 ? p99 + p99 / 2 + m_options.timeoutMargin : kUnknownTimeout;
+}
+
+int CHostPool::launches() const
+{
+  return m_launches;
+}
+
+void CHostPool::report(int index, CaseResult result, uint32_t ms)
+{
+  if (result == kCaseSuccess || result == kCaseFail)
+  {
+    m_history->record((*m_cases)[index], ms);
+  }
+  m_sink->onCaseResult(index, result, ms);
+}
+
+std::unique_ptr<CHost> CHostPool::launch()
+{
+  std::wstring channel = L"Local\\ArxTester-" + m_session + L"-" +
+    std::to_wstring(m_launches++);
+  std::unique_ptr<CHost> host = std::make_unique<CHost>(channel);
+  if (!host->cases.isValid() || !host->results.isValid() || !host->status.get() ||
+    !host->start.isValid())
+  {
+    return host;
+  }
+
+  std::vector<std::wstring> env;
+  env.emplace_back(std::wstring(strChannelEnv) + L"=" + channel);
+  env.emplace_back(std::wstring(strRunnerEnv) + L"=" +
+    std::to_wstring(CIpcProcess::currentId()));
+  if (m_options.bMinidump)
+  {
+    env.emplace_back(std::wstring(strMinidumpEnv) + L"=1");
+  }
+  host->process.spawn(m_cmdLine.c_str(), env);
+  return host;
+}
+
+void CHostPool::dispatch(CWorker& worker)
+{
+  if (m_bCancelled)
+  {
+    return;
+  }
+
+  if (worker.next >= worker.batch.size())
+  {
+    worker.next = 0;
+    if (!nextBatch(worker.batch))
+    {
+      while (!worker.standby.empty())
+      {
+        retire(std::move(worker.standby.front()));
+        worker.standby.pop_front();
+      }
+      m_active--;
+      checkFinished();
+      return;
+    }
+  }
+
+  while (!worker.standby.empty() && !worker.host)
+  {
+    worker.host = std::move(worker.standby.front());
+    worker.standby.pop_front();
+    if (!worker.host->process.isAlive())
+    {
+      worker.host.reset();
+    }
+  }
+  if (!worker.host)
+  {
+    worker.host = launch();
+  }
+
+  // Boot the replacements while this host is busy.
+  while ((int)worker.standby.size() < m_options.standby)
+  {
+    worker.standby.emplace_back(launch());
+  }
+
+  CHost& host = *worker.host;
+  if (!host.process.isValid())
+  {
+    for (; worker.next < worker.batch.size(); worker.next++)
+    {
+      report(worker.batch[worker.next], kCaseError, 0);
+    }
+    worker.host.reset();
+    m_loop->post([this, &worker] { dispatch(worker); });
+    return;
+  }
+
+  worker.sent = worker.next;
+  worker.bEnded = false;
+  feed(worker);
+  host.start.set();
+  m_sink->onCaseStart(worker.batch[worker.next]);
+
+  // The first case also has to wait for the host to come up.
+  worker.timer = m_loop->addTimer(m_options.startupTimeout + m_budgets[worker.batch[worker.next]],
+    [this, &worker] { onTimeout(worker); });
+  waitResults(worker);
+  m_loop->watch(host.process.handle(), [this, &worker] { onExit(worker); });
+
+  HostStatus* status = host.status.get();
+  worker.heartbeat = status ? status->heartbeat.load() : 0;
+  worker.progress = status ? status->progress.load() : 0;
+  worker.heartbeatAt = worker.progressAt = CEventLoop::now();
+  worker.bReports = false;
+  if (m_options.stallTimeout && status)
+  {
+    worker.watchdog = m_loop->addTimer(kStallCheck, [this, &worker] { checkStall(worker); });
+  }
+}
+
+void CHostPool::feed(CWorker& worker)
+{
+  // The queue is bounded; whatever does not fit now goes in as the host
+  // takes cases out.
+  CHost& host = *worker.host;
+  while (worker.sent < worker.batch.size())
+  {
+    int index = worker.batch[worker.sent];
+    CFrameWriter writer(m_frame.data(), m_frame.size());
+    writer.caseStart(toText((*m_cases)[index]).data(), m_arxLengths[index], m_ids[index]);
+    if (!host.cases.tryWrite(writer.data(), (uint32_t)writer.size()))
+    {
+      break;
+    }
+    worker.sent++;
+  }
+
+  // An empty message ends the queue.
+  if (worker.sent == worker.batch.size() && !worker.bEnded)
+  {
+    worker.bEnded = host.cases.tryWrite(nullptr, 0);
+  }
+}
+
+void CHostPool::waitResults(CWorker& worker)
+{
+  if (worker.host->results.armReadable())
+  {
+    m_loop->watch(worker.host->results.readableEvent(), [this, &worker] { onDone(worker); });
+  }
+  else
+  {
+    m_loop->post([this, &worker] { onDone(worker); });
+  }
+}
+
+bool CHostPool::drain(CWorker& worker)
+{
+  bool bProgress = false;
+  const void* data = nullptr;
+  uint32_t size = 0;
+  while (worker.next < worker.batch.size() && worker.host->results.peek(data, size))
+  {
+    CFrameReader reader(data, size);
+    Frame frame;
+    while (worker.next < worker.batch.size() && reader.next(frame))
+    {
+      int index = worker.batch[worker.next];
+      std::wstring text = fromText(frame.text);
+      switch (frame.type)
+      {
+      case kFrameCaseEnd:
+        report(index, frame.result == kCaseEndPass ? kCaseSuccess :
+          frame.result == kCaseEndFault ? kCaseCrash : kCaseFail, frame.ms);
+        worker.next++;
+        bProgress = true;
+        break;
+      case kFrameLog:
+      {
+        static const wchar_t* levels[] = { L"", L"debug: ", L"warning: ", L"error: " };
+        m_sink->onCaseLog(index, levels[(std::min)(frame.level, (uint32_t)kLogError)] +
+          trim(text));
+        break;
+      }
+      case kFrameAssert:
+        m_sink->onCaseLog(index, fromText(frame.file) + L"(" + std::to_wstring(frame.line) +
+          L"): " + text);
+        break;
+      case kFrameMetric:
+      {
+        char value[32];
+        snprintf(value, sizeof(value), "%g", frame.value);
+        m_sink->onCaseLog(index, text + L" = " + std::wstring(value, value + strlen(value)));
+        break;
+      }
+      case kFrameTiming:
+        m_sink->onCaseTiming(index, frame.timing);
+        break;
+      case kFrameArtifact:
+      {
+        // The handle is one of the host's; it keeps the section until it
+        // sees the frame counted, and drops it with the process anyway.
+        CIpcMemory artifact;
+        if (artifact.receive(worker.host->process, frame.handle, (size_t)frame.size))
+        {
+          m_sink->onCaseArtifact(index, text, artifact.data(), frame.size);
+        }
+        worker.host->status.get()->artifactsTaken++;
+        break;
+      }
+      default:
+        break;
+      }
+    }
+    worker.host->results.consume();
+  }
+
+  if (bProgress && worker.next < worker.batch.size())
+  {
+    // The next case has yet to show whether it reports progress.
+    worker.bReports = false;
+    worker.progressAt = CEventLoop::now();
+    feed(worker);
+    m_sink->onCaseStart(worker.batch[worker.next]);
+    m_loop->cancelTimer(worker.timer);
+    worker.timer = m_loop->addTimer(m_budgets[worker.batch[worker.next]],
+      [this, &worker] { onTimeout(worker); });
+  }
+  return bProgress;
+}
+
+void CHostPool::onDone(CWorker& worker)
+{
+  if (!worker.host)
+  {
+    return;
+  }
+
+  drain(worker);
+  if (worker.next < worker.batch.size())
+  {
+    waitResults(worker);
+    return;
+  }
+
+  release(worker);
+  dispatch(worker);
+}
+
+void CHostPool::onExit(CWorker& worker)
+{
+  // The host went away in the middle of the batch: blame the case it
+  // was running and resume after it on another host.
+  drain(worker);
+  if (worker.next < worker.batch.size())
+  {
+    report(worker.batch[worker.next++], kCaseCrash, 0);
+  }
+
+  release(worker);
+  dispatch(worker);
+}
+
+void CHostPool::onTimeout(CWorker& worker)
+{
+  worker.timer = 0;
+  // A result may have landed right at the deadline.
+  if (drain(worker))
+  {
+    return;
+  }
+
+  // The case is over its budget: the host is considered hung.
+  kill(worker, std::wstring());
+}
+
+void CHostPool::checkStall(CWorker& worker)
+{
+  worker.watchdog = 0;
+  HostStatus* status = worker.host->status.get();
+  uint64_t now = CEventLoop::now();
+  uint64_t heartbeat = status->heartbeat.load();
+  uint64_t progress = status->progress.load();
+  if (heartbeat != worker.heartbeat)
+  {
+    worker.heartbeat = heartbeat;
+    worker.heartbeatAt = now;
+  }
+  if (progress != worker.progress)
+  {
+    worker.progress = progress;
+    worker.progressAt = now;
+    worker.bReports = true;
+  }
+
+  // A heartbeat of 0 means the loader is not up yet; the startup
+  // timeout covers that.
+  if (worker.next >= worker.batch.size())
+  {
+    // The batch is over; the host is only winding down.
+  }
+  else if (heartbeat && now - worker.heartbeatAt > m_options.stallTimeout)
+  {
+    kill(worker, L"host stopped responding; a case that computes for long must call "
+      L"CDebuger::progress() or the suite must raise <StallTimeout>");
+  }
+  else if (worker.bReports && now - worker.progressAt > m_options.stallTimeout)
+  {
+    kill(worker, L"case stopped making progress");
+  }
+  else
+  {
+    worker.watchdog = m_loop->addTimer(kStallCheck, [this, &worker] { checkStall(worker); });
+  }
+}
+
+void CHostPool::kill(CWorker& worker, const std::wstring& reason)
+{
+  int index = worker.batch[worker.next++];
+  worker.host->process.kill();
+  if (!reason.empty())
+  {
+    m_sink->onCaseLog(index, L"error: " + reason);
+  }
+  report(index, kCaseTimeout, 0);
+
+  release(worker);
+  dispatch(worker);
+}
+
+void CHostPool::release(CWorker& worker)
+{
+  m_loop->cancelTimer(worker.timer);
+  worker.timer = 0;
+  m_loop->cancelTimer(worker.watchdog);
+  worker.watchdog = 0;
+  m_loop->unwatch(worker.host->results.readableEvent());
+  m_loop->unwatch(worker.host->process.handle());
+  retire(std::move(worker.host));
+}
+
+void CHostPool::retire(std::unique_ptr<CHost> host)
+{
+  if (!host || !host->process.isAlive())
+  {
+    return;
+  }
+
+  // A host with an empty queue runs exitAll and goes away on its own;
+  // give it a second before killing it.
+  CHost* key = host.get();
+  key->cases.tryWrite(nullptr, 0);
+  key->start.set();
+  CEventLoop::TimerId timer = m_loop->addTimer(1000, [key]
+  {
+    key->process.kill();
+  });
+  m_loop->watch(key->process.handle(), [this, key, timer]
+  {
+    m_loop->cancelTimer(timer);
+    m_retiring.erase(key);
+    checkFinished();
+  });
+  m_retiring[key] = std::move(host);
+}
+
+void CHostPool::checkFinished()
+{
+  if (!m_active && m_retiring.empty())
+  {
+    m_loop->stop();
+  }
+}
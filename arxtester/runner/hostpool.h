@@ -0,0 +1,173 @@
+#ifndef HOSTPOOL_H
+#define HOSTPOOL_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "eventloop.h"
+
+enum CaseResult
+{
+  kCaseSuccess = 0,
+  kCaseFail,
+  kCaseCrash,
+  kCaseError,
+  kCaseCancel,
+  kCaseTimeout,
+};
+
+struct CaseTiming;
+
+class IHostPoolSink
+{
+public:
+  // The case is next in line on a host.
+  virtual void onCaseStart(int index) {}
+  // A log line, assertion or metric the case reported while running.
+  virtual void onCaseLog(int index, const std::wstring& text) {}
+  // An artifact the case committed, mapped read-only for the call.
+  virtual void onCaseArtifact(int index, const std::wstring& name, const void* data,
+    uint64_t size) {}
+  // The loader's breakdown of the wall time of the case, just before its
+  // result.
+  virtual void onCaseTiming(int index, const CaseTiming& timing) {}
+  virtual void onCaseResult(int index, CaseResult result, uint32_t ms) = 0;
+};
+
+// The wall times of earlier runs, as far as the pool is concerned.
+// CCaseHistory keeps them in history.xml.
+class ICaseHistory
+{
+public:
+  // The expected wall time of the case, for the dispatch order.
+  virtual uint32_t estimate(const std::wstring& key) const = 0;
+  // The p-th percentile (0..100) of its wall times, 0 if unknown.
+  virtual uint32_t percentile(const std::wstring& key, int p) const = 0;
+  virtual void record(const std::wstring& key, uint32_t ms) = 0;
+};
+
+// The settings of a pool; CConfig::poolOptions() takes them from
+// config.xml. Times are in ms.
+struct HostPoolOptions
+{
+  HostPoolOptions()
+    : workers(1)
+    , batch(1)
+    , standby(0)
+    , timeout(0)
+    , timeoutMargin(0)
+    , startupTimeout(0)
+    , stallTimeout(0)
+    , bMinidump(false)
+  {
+  }
+
+  int workers;
+  int batch;
+  int standby;
+  // Budget of every case; 0 derives it from the history.
+  uint32_t timeout;
+  uint32_t timeoutMargin;
+  uint32_t startupTimeout;
+  // 0 turns the stall check off. Cases that compute longer than this
+  // without pumping messages must call CDebuger::progress().
+  uint32_t stallTimeout;
+  bool bMinidump;
+  // Budgets of single cases, by key.
+  std::map<std::wstring, uint32_t> timeouts;
+};
+
+class CHost;
+class CWorker;
+
+// Runs the cases on a pool of concurrent host processes. Every host owns
+// a private channel (shared mappings + events) so that several hosts can
+// be alive at the same time. A host is given a batch of up to `batch`
+// cases and reports every result as it finishes; when it crashes the
+// worker relaunches it for the rest of the batch. Each worker keeps
+// `standby` extra hosts booted and parked so that a launch never sits on
+// the critical path.
+//
+// Cases are dispatched longest first by their historical wall time, and a
+// batch never takes more than a worker's fair share of the remaining
+// estimated time, so the workers finish close together.
+//
+// Every case has a time budget: a configured timeout if there is one,
+// otherwise 1.5 times its historical p99 plus a margin. A host whose case
+// runs over budget is killed, the case is reported as timed out and the
+// worker moves on to the next one. With a `stallTimeout`, a host is also
+// killed early when its heartbeat stops, or when a case that reported
+// progress stops advancing, for that many ms.
+//
+// All hosts are supervised from the calling thread by a single event
+// loop: completion events, process exits, deadlines and cancellation are
+// callbacks on it, so the pool needs no thread per worker.
+//
+// The pool only builds on the ipc layer and the event loop, so it runs
+// wherever they do; on Linux that is the POSIX backend and epoll.
+class CHostPool
+{
+public:
+  // The channels of the hosts are named after session, so pools of
+  // different runs never share a kernel object. cancel is a manual-reset
+  // event (see CIpcEvent::handle()).
+  CHostPool(const std::wstring& cmdLine, const std::wstring& session,
+    const HostPoolOptions& options, LoopHandle cancel);
+  ~CHostPool();
+
+  // Returns false when the run was cancelled through cancel. Cases are
+  // keyed "arx:case". The wall time of every case that ran to completion
+  // is recorded in history.
+  bool run(const std::vector<std::wstring>& cases, ICaseHistory& history,
+    IHostPoolSink* sink);
+
+  // Hosts started so far, standby ones included.
+  int launches() const;
+
+private:
+  bool nextBatch(std::vector<int>& batch);
+  uint32_t budget(const std::wstring& key) const;
+  void report(int index, CaseResult result, uint32_t ms);
+  std::unique_ptr<CHost> launch();
+  void dispatch(CWorker& worker);
+  void feed(CWorker& worker);
+  void waitResults(CWorker& worker);
+  bool drain(CWorker& worker);
+  void onDone(CWorker& worker);
+  void onExit(CWorker& worker);
+  void onTimeout(CWorker& worker);
+  void checkStall(CWorker& worker);
+  void kill(CWorker& worker, const std::wstring& reason);
+  void release(CWorker& worker);
+  void retire(std::unique_ptr<CHost> host);
+  void checkFinished();
+
+private:
+  std::wstring m_cmdLine;
+  std::wstring m_session;
+  HostPoolOptions m_options;
+  LoopHandle m_cancel;
+
+  const std::vector<std::wstring>* m_cases;
+  ICaseHistory* m_history;
+  IHostPoolSink* m_sink;
+  std::unique_ptr<CEventLoop> m_loop;
+  std::vector<std::unique_ptr<CWorker>> m_workerList;
+  std::map<CHost*, std::unique_ptr<CHost>> m_retiring;
+  int m_active;
+  std::vector<uint8_t> m_frame;
+  std::vector<int> m_order;
+  std::vector<uint32_t> m_estimates;
+  std::vector<uint32_t> m_budgets;
+  std::vector<uint32_t> m_arxLengths;
+  std::vector<uint64_t> m_ids;
+  uint64_t m_remaining;
+  size_t m_next;
+  int m_launches;
+  bool m_bCancelled;
+};
+
+#endif//HOSTPOOL_H
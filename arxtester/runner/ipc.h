@@ -0,0 +1,134 @@
+#ifndef IPC_H
+#define IPC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "eventloop.h"
+
+// Waits without a deadline; same value as INFINITE.
+const uint32_t kIpcInfinite = 0xffffffff;
+
+// Thin platform layer under the channels and the host processes. Names are
+// Win32 kernel object names ("Local\ArxTester-..."); the POSIX backend
+// keeps the part after the last backslash and maps it to a shm_open name
+// and a FIFO under $XDG_RUNTIME_DIR (or /tmp).
+//
+// None of these objects are copyable; close() runs on destruction.
+
+class CIpcProcess;
+
+// A named shared memory section.
+class CIpcMemory
+{
+public:
+  CIpcMemory();
+  ~CIpcMemory();
+  CIpcMemory(const CIpcMemory&) = delete;
+  CIpcMemory& operator=(const CIpcMemory&) = delete;
+
+  // Creates the section, or maps the existing one of the same name. The
+  // creator removes the name again on close.
+  bool create(const wchar_t* name, size_t size);
+  // Maps all of an existing section.
+  bool open(const wchar_t* name);
+  // Maps size bytes, read-only, of an unnamed section that owner holds
+  // under handle. The value is only ever looked up in the table of owner,
+  // so a wrong one cannot reach a handle of this process; anything that is
+  // not a section of at least size bytes fails.
+  bool receive(const CIpcProcess& owner, uint64_t handle, size_t size);
+  void close();
+
+  void* data() const;
+  // What is actually mapped, which may be more than was asked for.
+  size_t size() const;
+
+private:
+  void* m_data;
+  size_t m_size;
+#ifdef _WIN32
+  void* m_hSection;
+#else
+  std::string m_unlink;
+#endif
+};
+
+// A named event shared by two processes. An auto-reset event is consumed
+// by the wait that sees it; a manual-reset one stays set until reset().
+class CIpcEvent
+{
+public:
+  CIpcEvent();
+  ~CIpcEvent();
+  CIpcEvent(const CIpcEvent&) = delete;
+  CIpcEvent& operator=(const CIpcEvent&) = delete;
+
+  bool create(const wchar_t* name, bool bManualReset);
+  bool open(const wchar_t* name, bool bManualReset);
+  void close();
+  bool isValid() const;
+
+  void set();
+  void reset();
+  // True when the event got set within timeout ms.
+  bool wait(uint32_t timeout);
+
+  // For CEventLoop::watch(). The loop does not consume an auto-reset
+  // event on POSIX: reset() it before waiting on it again.
+  LoopHandle handle() const;
+
+private:
+  bool m_bManualReset;
+#ifdef _WIN32
+  void* m_hEvent;
+#else
+  int m_fd;
+  std::string m_unlink;
+#endif
+};
+
+// A child process.
+class CIpcProcess
+{
+public:
+  CIpcProcess();
+  // Closes the handle; the process keeps running.
+  ~CIpcProcess();
+  CIpcProcess(const CIpcProcess&) = delete;
+  CIpcProcess& operator=(const CIpcProcess&) = delete;
+
+  // Starts cmdLine, a Win32-style command line, with the environment of
+  // this process plus the NAME=value entries of env, which win over
+  // inherited variables of the same name.
+  bool spawn(const wchar_t* cmdLine, const std::vector<std::wstring>& env);
+  bool isValid() const;
+
+  bool isAlive();
+  // True when the process ended within timeout ms.
+  bool wait(uint32_t timeout);
+  void kill();
+
+  // Signalled once the process ended, for CEventLoop::watch().
+  LoopHandle handle() const;
+  // Hands the native handle over to the caller.
+  LoopHandle detach();
+
+  // The id of this process, as hosts are told in strRunnerEnv.
+  static uint32_t currentId();
+
+private:
+  void close();
+
+private:
+#ifdef _WIN32
+  void* m_hProcess;
+#else
+  int m_pid;
+  int m_pidfd;
+  bool m_bReaped;
+#endif
+};
+
+#endif//IPC_H
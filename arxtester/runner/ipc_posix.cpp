@@ -0,0 +1,519 @@
+#ifndef _WIN32
+
+#include "ipc.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+static std::string narrow(const std::wstring& str)
+{
+  std::string out;
+  for (wchar_t wc : str)
+  {
+    uint32_t c = (uint32_t)wc;
+    if (c < 0x80)
+    {
+      out += (char)c;
+    }
+    else if (c < 0x800)
+    {
+      out += (char)(0xc0 | (c >> 6));
+      out += (char)(0x80 | (c & 0x3f));
+    }
+    else if (c < 0x10000)
+    {
+      out += (char)(0xe0 | (c >> 12));
+      out += (char)(0x80 | ((c >> 6) & 0x3f));
+      out += (char)(0x80 | (c & 0x3f));
+    }
+    else
+    {
+      out += (char)(0xf0 | (c >> 18));
+      out += (char)(0x80 | ((c >> 12) & 0x3f));
+      out += (char)(0x80 | ((c >> 6) & 0x3f));
+      out += (char)(0x80 | (c & 0x3f));
+    }
+  }
+  return out;
+}
+
+// "Local\ArxTester-1-0-Cases" -> "ArxTester-1-0-Cases".
+static std::string baseName(const wchar_t* name)
+{
+  const wchar_t* slash = wcsrchr(name, L'\\');
+  std::string base = narrow(slash ? slash + 1 : name);
+  for (char& c : base)
+  {
+    if (c == '/')
+    {
+      c = '_';
+    }
+  }
+  return base;
+}
+
+static std::string eventPath(const wchar_t* name)
+{
+  const char* dir = getenv("XDG_RUNTIME_DIR");
+  return std::string(dir && *dir ? dir : "/tmp") + "/" + baseName(name) + ".event";
+}
+
+static int pollFor(int fd, uint32_t timeout)
+{
+  pollfd pfd = { fd, POLLIN, 0 };
+  int ret;
+  do
+  {
+    ret = poll(&pfd, 1, timeout == kIpcInfinite ? -1 : (int)timeout);
+  } while (ret < 0 && errno == EINTR);
+  return ret;
+}
+
+CIpcMemory::CIpcMemory()
+  : m_data(nullptr)
+  , m_size(0)
+{
+}
+
+CIpcMemory::~CIpcMemory()
+{
+  close();
+}
+
+bool CIpcMemory::create(const wchar_t* name, size_t size)
+{
+  close();
+  std::string shm = "/" + baseName(name);
+  int fd = shm_open(shm.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0600);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  struct stat st = {};
+  if (fstat(fd, &st) != 0 || ((size_t)st.st_size < size && ftruncate(fd, (off_t)size) != 0))
+  {
+    ::close(fd);
+    shm_unlink(shm.c_str());
+    return false;
+  }
+
+  void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+  {
+    shm_unlink(shm.c_str());
+    return false;
+  }
+  m_data = data;
+  m_size = size;
+  m_unlink = shm;
+  return true;
+}
+
+bool CIpcMemory::open(const wchar_t* name)
+{
+  close();
+  std::string shm = "/" + baseName(name);
+  int fd = shm_open(shm.c_str(), O_RDWR | O_CLOEXEC, 0);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  struct stat st = {};
+  void* data = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0)
+  {
+    data = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  ::close(fd);
+  if (data == MAP_FAILED)
+  {
+    return false;
+  }
+  m_data = data;
+  m_size = (size_t)st.st_size;
+  return true;
+}
+
+bool CIpcMemory::receive(const CIpcProcess& owner, uint64_t handle, size_t size)
+{
+  close();
+  if (owner.handle() < 0 || !size || handle > INT32_MAX)
+  {
+    return false;
+  }
+
+  int fd = -1;
+#ifdef SYS_pidfd_getfd
+  fd = (int)syscall(SYS_pidfd_getfd, owner.handle(), (int)handle, 0);
+#endif
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  struct stat st = {};
+  void* data = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && (uint64_t)st.st_size >= size)
+  {
+    data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  ::close(fd);
+  if (data == MAP_FAILED)
+  {
+    return false;
+  }
+  m_data = data;
+  m_size = size;
+  return true;
+}
+
+void CIpcMemory::close()
+{
+  if (m_data)
+  {
+    munmap(m_data, m_size);
+    m_data = nullptr;
+  }
+  if (!m_unlink.empty())
+  {
+    shm_unlink(m_unlink.c_str());
+    m_unlink.clear();
+  }
+  m_size = 0;
+}
+
+void* CIpcMemory::data() const
+{
+  return m_data;
+}
+
+size_t CIpcMemory::size() const
+{
+  return m_size;
+}
+
+// An event is a FIFO opened for both reading and writing, so that it can
+// be opened without a peer and polled by the epoll loop: set() writes a
+// byte, and consuming the event drains the FIFO.
+CIpcEvent::CIpcEvent()
+  : m_bManualReset(false)
+  , m_fd(-1)
+{
+}
+
+CIpcEvent::~CIpcEvent()
+{
+  close();
+}
+
+bool CIpcEvent::create(const wchar_t* name, bool bManualReset)
+{
+  close();
+  std::string path = eventPath(name);
+  if (mkfifo(path.c_str(), 0600) != 0 && errno != EEXIST)
+  {
+    return false;
+  }
+  m_bManualReset = bManualReset;
+  m_fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (m_fd < 0)
+  {
+    unlink(path.c_str());
+    return false;
+  }
+  m_unlink = path;
+  return true;
+}
+
+bool CIpcEvent::open(const wchar_t* name, bool bManualReset)
+{
+  close();
+  m_bManualReset = bManualReset;
+  m_fd = ::open(eventPath(name).c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  return m_fd >= 0;
+}
+
+void CIpcEvent::close()
+{
+  if (m_fd >= 0)
+  {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+  if (!m_unlink.empty())
+  {
+    unlink(m_unlink.c_str());
+    m_unlink.clear();
+  }
+}
+
+bool CIpcEvent::isValid() const
+{
+  return m_fd >= 0;
+}
+
+void CIpcEvent::set()
+{
+  // A full FIFO is set already.
+  char c = 1;
+  ssize_t ret = write(m_fd, &c, 1);
+  (void)ret;
+}
+
+void CIpcEvent::reset()
+{
+  char buf[64];
+  while (read(m_fd, buf, sizeof(buf)) > 0)
+  {
+  }
+}
+
+bool CIpcEvent::wait(uint32_t timeout)
+{
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+  for (;;)
+  {
+    if (pollFor(m_fd, timeout) <= 0)
+    {
+      return false;
+    }
+    if (m_bManualReset)
+    {
+      return true;
+    }
+
+    char buf[64];
+    if (read(m_fd, buf, sizeof(buf)) > 0)
+    {
+      reset();
+      return true;
+    }
+
+    // Another waiter took it; wait for the rest of the timeout.
+    if (timeout != kIpcInfinite)
+    {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now()).count();
+      if (left <= 0)
+      {
+        return false;
+      }
+      timeout = (uint32_t)left;
+    }
+  }
+}
+
+LoopHandle CIpcEvent::handle() const
+{
+  return m_fd;
+}
+
+// Splits a Win32-style command line: blanks separate arguments, double
+// quotes group them and \" is a literal quote.
+static std::vector<std::string> splitCommandLine(const wchar_t* cmdLine)
+{
+  std::vector<std::string> args;
+  std::wstring arg;
+  bool bArg = false;
+  bool bQuoted = false;
+  for (const wchar_t* p = cmdLine; *p; p++)
+  {
+    if (*p == L'\\' && p[1] == L'"')
+    {
+      arg += L'"';
+      bArg = true;
+      p++;
+    }
+    else if (*p == L'"')
+    {
+      bQuoted = !bQuoted;
+      bArg = true;
+    }
+    else if ((*p == L' ' || *p == L'\t') && !bQuoted)
+    {
+      if (bArg)
+      {
+        args.emplace_back(narrow(arg));
+        arg.clear();
+        bArg = false;
+      }
+    }
+    else
+    {
+      arg += *p;
+      bArg = true;
+    }
+  }
+  if (bArg)
+  {
+    args.emplace_back(narrow(arg));
+  }
+  return args;
+}
+
+CIpcProcess::CIpcProcess()
+  : m_pid(0)
+  , m_pidfd(-1)
+  , m_bReaped(false)
+{
+}
+
+CIpcProcess::~CIpcProcess()
+{
+  close();
+}
+
+bool CIpcProcess::spawn(const wchar_t* cmdLine, const std::vector<std::wstring>& env)
+{
+  close();
+  std::vector<std::string> args = splitCommandLine(cmdLine);
+  if (args.empty())
+  {
+    return false;
+  }
+
+  std::set<std::string> names;
+  std::vector<std::string> vars;
+  for (const std::wstring& str : env)
+  {
+    vars.emplace_back(narrow(str));
+    names.emplace(vars.back().substr(0, vars.back().find('=')));
+  }
+  for (char** p = environ; *p; p++)
+  {
+    const char* eq = strchr(*p, '=');
+    if (names.find(eq ? std::string(*p, eq - *p) : std::string(*p)) == names.end())
+    {
+      vars.emplace_back(*p);
+    }
+  }
+
+  std::vector<char*> argv;
+  for (std::string& str : args)
+  {
+    argv.push_back(&str[0]);
+  }
+  argv.push_back(nullptr);
+  std::vector<char*> envp;
+  for (std::string& str : vars)
+  {
+    envp.push_back(&str[0]);
+  }
+  envp.push_back(nullptr);
+
+  pid_t pid = 0;
+  if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), envp.data()) != 0)
+  {
+    return false;
+  }
+  m_pid = pid;
+  m_bReaped = false;
+#ifdef SYS_pidfd_open
+  m_pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+#endif
+  return true;
+}
+
+bool CIpcProcess::isValid() const
+{
+  return m_pid != 0;
+}
+
+bool CIpcProcess::isAlive()
+{
+  if (!m_pid || m_bReaped)
+  {
+    return false;
+  }
+  int status = 0;
+  pid_t ret = waitpid(m_pid, &status, WNOHANG);
+  if (ret == 0)
+  {
+    return true;
+  }
+  m_bReaped = true;
+  return false;
+}
+
+bool CIpcProcess::wait(uint32_t timeout)
+{
+  if (!isAlive())
+  {
+    return true;
+  }
+  if (m_pidfd >= 0)
+  {
+    pollFor(m_pidfd, timeout);
+    return !isAlive();
+  }
+
+  // No pidfd on this kernel: poll the exit status.
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+  while (isAlive())
+  {
+    if (timeout != kIpcInfinite && std::chrono::steady_clock::now() >= deadline)
+    {
+      return false;
+    }
+    usleep(10000);
+  }
+  return true;
+}
+
+void CIpcProcess::kill()
+{
+  if (m_pid && !m_bReaped)
+  {
+    ::kill(m_pid, SIGKILL);
+  }
+}
+
+LoopHandle CIpcProcess::handle() const
+{
+  return m_pidfd;
+}
+
+LoopHandle CIpcProcess::detach()
+{
+  int pidfd = m_pidfd;
+  m_pidfd = -1;
+  m_pid = 0;
+  return pidfd;
+}
+
+uint32_t CIpcProcess::currentId()
+{
+  return (uint32_t)getpid();
+}
+
+void CIpcProcess::close()
+{
+  // Reaps the child if it is gone already.
+  isAlive();
+  if (m_pidfd >= 0)
+  {
+    ::close(m_pidfd);
+    m_pidfd = -1;
+  }
+  m_pid = 0;
+}
+
+#endif//_WIN32
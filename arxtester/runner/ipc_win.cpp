@@ -0,0 +1,301 @@
+#ifdef _WIN32
+
+#include "ipc.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <cwctype>
+#include <set>
+
+CIpcMemory::CIpcMemory()
+  : m_data(nullptr)
+  , m_size(0)
+  , m_hSection(nullptr)
+{
+}
+
+CIpcMemory::~CIpcMemory()
+{
+  close();
+}
+
+bool CIpcMemory::create(const wchar_t* name, size_t size)
+{
+  close();
+  ULONGLONG max = size;
+  m_hSection = CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+    (DWORD)(max >> 32), (DWORD)max, name);
+  if (!m_hSection)
+  {
+    return false;
+  }
+
+  m_data = MapViewOfFile(m_hSection, FILE_MAP_WRITE | FILE_MAP_READ, 0, 0, size);
+  if (!m_data)
+  {
+    close();
+    return false;
+  }
+  m_size = size;
+  return true;
+}
+
+bool CIpcMemory::open(const wchar_t* name)
+{
+  close();
+  m_hSection = OpenFileMapping(FILE_MAP_WRITE | FILE_MAP_READ, FALSE, name);
+  if (!m_hSection)
+  {
+    return false;
+  }
+
+  m_data = MapViewOfFile(m_hSection, FILE_MAP_WRITE | FILE_MAP_READ, 0, 0, 0);
+  if (!m_data)
+  {
+    close();
+    return false;
+  }
+
+  MEMORY_BASIC_INFORMATION mbi = { 0 };
+  VirtualQuery(m_data, &mbi, sizeof(mbi));
+  m_size = mbi.RegionSize;
+  return true;
+}
+
+bool CIpcMemory::receive(const CIpcProcess& owner, uint64_t handle, size_t size)
+{
+  close();
+  if (!owner.handle() || !size)
+  {
+    return false;
+  }
+  if (!DuplicateHandle(owner.handle(), (HANDLE)(ULONG_PTR)handle, GetCurrentProcess(),
+    &m_hSection, FILE_MAP_READ, FALSE, 0))
+  {
+    m_hSection = nullptr;
+    return false;
+  }
+
+  // Fails for anything but a section, and for one smaller than size.
+  m_data = MapViewOfFile(m_hSection, FILE_MAP_READ, 0, 0, size);
+  if (!m_data)
+  {
+    close();
+    return false;
+  }
+  m_size = size;
+  return true;
+}
+
+void CIpcMemory::close()
+{
+  if (m_data)
+  {
+    UnmapViewOfFile(m_data);
+    m_data = nullptr;
+  }
+  if (m_hSection)
+  {
+    CloseHandle(m_hSection);
+    m_hSection = nullptr;
+  }
+  m_size = 0;
+}
+
+void* CIpcMemory::data() const
+{
+  return m_data;
+}
+
+size_t CIpcMemory::size() const
+{
+  return m_size;
+}
+
+CIpcEvent::CIpcEvent()
+  : m_bManualReset(false)
+  , m_hEvent(nullptr)
+{
+}
+
+CIpcEvent::~CIpcEvent()
+{
+  close();
+}
+
+bool CIpcEvent::create(const wchar_t* name, bool bManualReset)
+{
+  close();
+  m_bManualReset = bManualReset;
+  m_hEvent = CreateEvent(nullptr, bManualReset, FALSE, name);
+  return m_hEvent != nullptr;
+}
+
+bool CIpcEvent::open(const wchar_t* name, bool bManualReset)
+{
+  close();
+  m_bManualReset = bManualReset;
+  m_hEvent = OpenEvent(SYNCHRONIZE | EVENT_MODIFY_STATE, FALSE, name);
+  return m_hEvent != nullptr;
+}
+
+void CIpcEvent::close()
+{
+  if (m_hEvent)
+  {
+    CloseHandle(m_hEvent);
+    m_hEvent = nullptr;
+  }
+}
+
+bool CIpcEvent::isValid() const
+{
+  return m_hEvent != nullptr;
+}
+
+void CIpcEvent::set()
+{
+  SetEvent(m_hEvent);
+}
+
+void CIpcEvent::reset()
+{
+  ResetEvent(m_hEvent);
+}
+
+bool CIpcEvent::wait(uint32_t timeout)
+{
+  return WAIT_OBJECT_0 == WaitForSingleObject(m_hEvent, timeout);
+}
+
+LoopHandle CIpcEvent::handle() const
+{
+  return m_hEvent;
+}
+
+// The environment of this process without the variables env overrides,
+// followed by env, as a CreateProcess block. Names compare case-blind.
+static std::vector<wchar_t> makeEnvironment(const std::vector<std::wstring>& env)
+{
+  auto upperName = [](const wchar_t* str)
+  {
+    const wchar_t* eq = wcschr(str + 1, L'=');
+    std::wstring name = eq ? std::wstring(str, eq - str) : std::wstring(str);
+    std::transform(name.begin(), name.end(), name.begin(), towupper);
+    return name;
+  };
+
+  std::set<std::wstring> names;
+  for (const std::wstring& str : env)
+  {
+    names.emplace(upperName(str.c_str()));
+  }
+
+  std::vector<wchar_t> block;
+  wchar_t* strings = GetEnvironmentStrings();
+  if (strings)
+  {
+    for (wchar_t* p = strings; *p; p += wcslen(p) + 1)
+    {
+      if (names.find(upperName(p)) == names.end())
+      {
+        block.insert(block.end(), p, p + wcslen(p) + 1);
+      }
+    }
+    FreeEnvironmentStrings(strings);
+  }
+
+  for (const std::wstring& str : env)
+  {
+    block.insert(block.end(), str.c_str(), str.c_str() + str.size() + 1);
+  }
+  block.emplace_back(L'\0');
+  return block;
+}
+
+CIpcProcess::CIpcProcess()
+  : m_hProcess(nullptr)
+{
+}
+
+CIpcProcess::~CIpcProcess()
+{
+  close();
+}
+
+bool CIpcProcess::spawn(const wchar_t* cmdLine, const std::vector<std::wstring>& env)
+{
+  close();
+  std::vector<wchar_t> block;
+  if (!env.empty())
+  {
+    block = makeEnvironment(env);
+  }
+
+  // CreateProcess may write to the command line.
+  std::vector<wchar_t> line(cmdLine, cmdLine + wcslen(cmdLine) + 1);
+  STARTUPINFO si = { 0 };
+  si.cb = sizeof(si);
+  PROCESS_INFORMATION pi = { 0 };
+  if (!CreateProcess(nullptr, line.data(), nullptr, nullptr, FALSE,
+    CREATE_UNICODE_ENVIRONMENT, block.empty() ? nullptr : block.data(), nullptr,
+    &si, &pi))
+  {
+    return false;
+  }
+  CloseHandle(pi.hThread);
+  m_hProcess = pi.hProcess;
+  return true;
+}
+
+bool CIpcProcess::isValid() const
+{
+  return m_hProcess != nullptr;
+}
+
+bool CIpcProcess::isAlive()
+{
+  return m_hProcess && WAIT_TIMEOUT == WaitForSingleObject(m_hProcess, 0);
+}
+
+bool CIpcProcess::wait(uint32_t timeout)
+{
+  return !m_hProcess || WAIT_OBJECT_0 == WaitForSingleObject(m_hProcess, timeout);
+}
+
+void CIpcProcess::kill()
+{
+  if (m_hProcess)
+  {
+    TerminateProcess(m_hProcess, 0);
+  }
+}
+
+LoopHandle CIpcProcess::handle() const
+{
+  return m_hProcess;
+}
+
+LoopHandle CIpcProcess::detach()
+{
+  HANDLE hProcess = m_hProcess;
+  m_hProcess = nullptr;
+  return hProcess;
+}
+
+uint32_t CIpcProcess::currentId()
+{
+  return GetCurrentProcessId();
+}
+
+void CIpcProcess::close()
+{
+  if (m_hProcess)
+  {
+    CloseHandle(m_hProcess);
+    m_hProcess = nullptr;
+  }
+}
+
+#endif//_WIN32
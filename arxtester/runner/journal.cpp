@@ -0,0 +1,147 @@
+#include "pch.h"
+#include "results.h"
+#include "journal.h"
+
+static void parseJournal(const std::vector<char>& data, size_t size, JournalResults& done)
+{
+  CString text = CA2W(CStringA(data.data(), (int)size), CP_UTF8);
+  int pos = 0;
+  CString line = text.Tokenize(L"\n", pos);
+  while (pos != -1)
+  {
+    // "<result>\t<ms>\t<arx:case>"; start lines have no ms field.
+    int tab1 = line.Find(L'\t');
+    int tab2 = tab1 == -1 ? -1 : line.Find(L'\t', tab1 + 1);
+    CaseResult result = kCaseSuccess;
+    if (tab2 != -1 && parseResultName(line.Left(tab1), result) && result != kCaseCancel)
+    {
+      JournalEntry& entry = done[(LPCTSTR)line.Mid(tab2 + 1)];
+      entry.result = result;
+      entry.ms = wcstoul(line.Mid(tab1 + 1, tab2 - tab1 - 1), nullptr, 10);
+    }
+    line = text.Tokenize(L"\n", pos);
+  }
+}
+
+// "Local\ArxTester-Journal-<hash of the path>"; paths compare case-blind.
+static CString lockName(const CString& path)
+{
+  CString upper = path;
+  upper.MakeUpper();
+  CString name;
+  name.Format(L"Local\\ArxTester-Journal-%016llx",
+    (unsigned long long)std::hash<std::wstring>()((LPCTSTR)upper));
+  return name;
+}
+
+CRunJournal::CRunJournal()
+  : m_hFile(INVALID_HANDLE_VALUE)
+  , m_hLock(nullptr)
+  , m_bBusy(false)
+{
+}
+
+CRunJournal::~CRunJournal()
+{
+  close(false);
+}
+
+bool CRunJournal::open(const CString& path, bool bResume, JournalResults& done)
+{
+  close(false);
+  done.clear();
+
+  m_path = path;
+  m_bBusy = false;
+  m_hLock = CreateMutex(nullptr, FALSE, lockName(path));
+  if (m_hLock && GetLastError() == ERROR_ALREADY_EXISTS)
+  {
+    CloseHandle(m_hLock);
+    m_hLock = nullptr;
+    m_bBusy = true;
+    return false;
+  }
+
+  m_hFile = CreateFile(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+    nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (m_hFile == INVALID_HANDLE_VALUE)
+  {
+    return false;
+  }
+
+  // Keep everything up to the last complete line and append after it.
+  LARGE_INTEGER end = { 0 };
+  if (bResume)
+  {
+    LARGE_INTEGER size = { 0 };
+    GetFileSizeEx(m_hFile, &size);
+    std::vector<char> data((size_t)size.QuadPart);
+    DWORD read = 0;
+    if (!data.empty() && ReadFile(m_hFile, data.data(), (DWORD)data.size(), &read, nullptr))
+    {
+      size_t complete = read;
+      while (complete && data[complete - 1] != '\n')
+      {
+        complete--;
+      }
+      parseJournal(data, complete, done);
+      end.QuadPart = complete;
+    }
+  }
+  SetFilePointerEx(m_hFile, end, nullptr, FILE_BEGIN);
+  SetEndOfFile(m_hFile);
+  return true;
+}
+
+bool CRunJournal::isBusy() const
+{
+  return m_bBusy;
+}
+
+void CRunJournal::close(bool bRemove)
+{
+  if (m_hFile != INVALID_HANDLE_VALUE)
+  {
+    CloseHandle(m_hFile);
+    m_hFile = INVALID_HANDLE_VALUE;
+    if (bRemove)
+    {
+      DeleteFile(m_path);
+    }
+  }
+  if (m_hLock)
+  {
+    CloseHandle(m_hLock);
+    m_hLock = nullptr;
+  }
+}
+
+void CRunJournal::start(const CString& key)
+{
+  writeLine(L"start\t" + key, false);
+}
+
+void CRunJournal::finish(const CString& key, CaseResult result, DWORD ms)
+{
+  CString line;
+  line.Format(L"%s\t%u\t%s", resultName(result), ms, (LPCTSTR)key);
+  writeLine(line, true);
+}
+
+void CRunJournal::writeLine(const CString& line, bool bFlush)
+{
+  if (m_hFile == INVALID_HANDLE_VALUE)
+  {
+    return;
+  }
+
+  // One WriteFile per record; a record torn by a crash has no newline and
+  // is dropped when the journal is resumed.
+  CStringA utf8 = CW2A(line + L"\n", CP_UTF8);
+  DWORD written = 0;
+  WriteFile(m_hFile, (LPCSTR)utf8, utf8.GetLength(), &written, nullptr);
+  if (bFlush)
+  {
+    FlushFileBuffers(m_hFile);
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "hostpool.h"
+
+struct JournalEntry
+{
+  CaseResult result;
+  DWORD ms;
+};
+typedef std::map<std::wstring, JournalEntry> JournalResults;
+
+// Append-only record of a run, kept so that a run cut short by a crash of
+// the runner or a reboot can be resumed. Every line is either
+// "start\t<arx:case>" when a case is handed to a host, or a result line
+// as in the result file when it finishes. Result lines are flushed to
+// disk before the call returns; a torn last line is ignored.
+//
+// A journal belongs to one runner at a time: open() holds a named mutex
+// derived from its path until close(), and fails with isBusy() while
+// another runner has it.
+class CRunJournal
+{
+public:
+  CRunJournal();
+  ~CRunJournal();
+
+  // Starts a new journal at path, or with bResume continues the existing
+  // one and returns the cases it already finished in done.
+  bool open(const CString& path, bool bResume, JournalResults& done);
+  // Whether the last open() failed because another runner has the journal.
+  bool isBusy() const;
+  // Closes the journal and, when bRemove, deletes it: the run is over
+  // and there is nothing left to resume.
+  void close(bool bRemove);
+
+  void start(const CString& key);
+  void finish(const CString& key, CaseResult result, DWORD ms);
+
+private:
+  void writeLine(const CString& line, bool bFlush);
+
+private:
+  CString m_path;
+  HANDLE m_hFile;
+  HANDLE m_hLock;
+  bool m_bBusy;
+};
+
+#endif//JOURNAL_H
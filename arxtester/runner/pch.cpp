@@ -1,6 +1,7 @@
 ﻿// pch.cpp: 与预编译标头对应的源文件
 
 #include "pch.h"
+#include "ipc.h"
 
 // 当使用预编译的头时，需要使用此源文件，编译才能成功。
 
@@ -57,16 +58,78 @@ CString documentsPath()
   return L"";
 }
 
-HANDLE startProc(wchar_t* szCommandLine)
+CString newSessionId()
 {
-  STARTUPINFO si = { 0 };
-  si.cb = sizeof(si);
-  PROCESS_INFORMATION pi = { 0 };
-  if (CreateProcess(nullptr, szCommandLine,
-    nullptr, nullptr, FALSE, 0, nullptr, nullptr,
-    &si, &pi))
+  static LONG runs = 0;
+  SYSTEMTIME st = { 0 };
+  GetLocalTime(&st);
+  CString id;
+  id.Format(L"%04u%02u%02u-%02u%02u%02u-%u-%d", st.wYear, st.wMonth, st.wDay,
+    st.wHour, st.wMinute, st.wSecond, GetCurrentProcessId(), InterlockedIncrement(&runs));
+  return id;
+}
+
+HANDLE startProc(wchar_t* szCommandLine, const CStringArray* env)
+{
+  std::vector<std::wstring> vars;
+  for (int i = 0; env && i < env->GetCount(); i++)
   {
-    return pi.hProcess;
+    vars.emplace_back((LPCTSTR)env->GetAt(i));
   }
-  return nullptr;
+
+  CIpcProcess process;
+  return process.spawn(szCommandLine, vars) ? process.detach() : nullptr;
+}
+
+CString fileHash(const CString& path)
+{
+  HANDLE hFile = CreateFile(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+    nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (hFile == INVALID_HANDLE_VALUE)
+  {
+    return CString();
+  }
+
+  ULONGLONG hash = 14695981039346656037ULL;
+  std::vector<BYTE> buf(1 << 16);
+  DWORD read = 0;
+  while (ReadFile(hFile, buf.data(), (DWORD)buf.size(), &read, nullptr) && read)
+  {
+    for (DWORD i = 0; i < read; i++)
+    {
+      hash = (hash ^ buf[i]) * 1099511628211ULL;
+    }
+  }
+  CloseHandle(hFile);
+
+  CString str;
+  str.Format(L"%016llx", hash);
+  return str;
+}
+
+#pragma comment(lib, "version.lib")
+
+CString fileVersion(const CString& path)
+{
+  DWORD handle = 0;
+  DWORD size = GetFileVersionInfoSize(path, &handle);
+  if (!size)
+  {
+    return CString();
+  }
+
+  std::vector<BYTE> info(size);
+  VS_FIXEDFILEINFO* fixed = nullptr;
+  UINT len = 0;
+  if (!GetFileVersionInfo(path, 0, size, info.data()) ||
+    !VerQueryValue(info.data(), L"\\", (LPVOID*)&fixed, &len) || !fixed)
+  {
+    return CString();
+  }
+
+  CString str;
+  str.Format(L"%u.%u.%u.%u",
+    HIWORD(fixed->dwFileVersionMS), LOWORD(fixed->dwFileVersionMS),
+    HIWORD(fixed->dwFileVersionLS), LOWORD(fixed->dwFileVersionLS));
+  return str;
 }
@@ -45,12 +45,16 @@
 #include <set>
 #include <vector>
 #include <list>
+#include <deque>
+#include <memory>
 #include <string>
 #include <algorithm>
 #include <ctime>
 #include <chrono>
 #include <sstream>
 #include <thread>
+#include <mutex>
+#include <atomic>
 #include <condition_variable>
 
 #include "../inc/gcommon.h"
@@ -58,7 +62,15 @@
 
 CString documentsPath();
 CString getAutoCadInstallDir();
-HANDLE startProc(wchar_t* szCommandLine);
+HANDLE startProc(wchar_t* szCommandLine, const CStringArray* env = nullptr);
+// 64-bit FNV-1a of the file contents as 16 hex digits, empty if unreadable.
+CString fileHash(const CString& path);
+// "a.b.c.d" from the version resource, empty if there is none.
+CString fileVersion(const CString& path);
+// "<yyyymmdd-hhmmss>-<pid>-<n>", unique to one run on this machine. The
+// kernel objects and files of a run are named after it, so runners can
+// run side by side.
+CString newSessionId();
 
 #ifdef _UNICODE
 #if defined _M_IX86
@@ -0,0 +1,330 @@
+#include "protocol.h"
+
+#include <cstring>
+
+static const size_t kHeaderSize = 8;
+
+size_t textSize(uint32_t length)
+{
+  return (sizeof(uint32_t) + (size_t)length * sizeof(char16_t) + 3) & ~(size_t)3;
+}
+
+CFrameWriter::CFrameWriter(void* buf, size_t capacity)
+  : m_buf((uint8_t*)buf)
+  , m_capacity(capacity)
+  , m_size(0)
+{
+}
+
+const void* CFrameWriter::data() const
+{
+  return m_buf;
+}
+
+size_t CFrameWriter::size() const
+{
+  return m_size;
+}
+
+void CFrameWriter::clear()
+{
+  m_size = 0;
+}
+
+bool CFrameWriter::begin(FrameType type, size_t body)
+{
+  if (body > UINT32_MAX || m_capacity - m_size < kHeaderSize + body)
+  {
+    return false;
+  }
+
+  uint8_t* p = m_buf + m_size;
+  p[0] = kProtocolVersion;
+  p[1] = (uint8_t)type;
+  p[2] = 0;
+  p[3] = 0;
+  m_size += 4;
+  putU32((uint32_t)body);
+  return true;
+}
+
+void CFrameWriter::putU32(uint32_t value)
+{
+  memcpy(m_buf + m_size, &value, sizeof(value));
+  m_size += sizeof(value);
+}
+
+void CFrameWriter::putU64(uint64_t value)
+{
+  memcpy(m_buf + m_size, &value, sizeof(value));
+  m_size += sizeof(value);
+}
+
+void CFrameWriter::putText(const char16_t* text, uint32_t length)
+{
+  size_t size = textSize(length);
+  putU32(length);
+  if (length)
+  {
+    memcpy(m_buf + m_size, text, length * sizeof(char16_t));
+  }
+  memset(m_buf + m_size + length * sizeof(char16_t), 0,
+    size - sizeof(uint32_t) - length * sizeof(char16_t));
+  m_size += size - sizeof(uint32_t);
+}
+
+bool CFrameWriter::caseStart(const char16_t* arx, uint32_t length, uint64_t id)
+{
+  if (!begin(kFrameCaseStart, textSize(length) + 8))
+  {
+    return false;
+  }
+  putText(arx, length);
+  putU64(id);
+  return true;
+}
+
+bool CFrameWriter::assertion(const char16_t* message, uint32_t length,
+  const char16_t* file, uint32_t fileLength, uint32_t line)
+{
+  if (!begin(kFrameAssert, textSize(length) + textSize(fileLength) + 4))
+  {
+    return false;
+  }
+  putText(message, length);
+  putText(file, fileLength);
+  putU32(line);
+  return true;
+}
+
+bool CFrameWriter::log(uint32_t level, const char16_t* text, uint32_t length)
+{
+  if (!begin(kFrameLog, textSize(length) + 4))
+  {
+    return false;
+  }
+  putText(text, length);
+  putU32(level);
+  return true;
+}
+
+bool CFrameWriter::metric(const char16_t* name, uint32_t length, double value)
+{
+  if (!begin(kFrameMetric, textSize(length) + 8))
+  {
+    return false;
+  }
+  putText(name, length);
+  uint64_t bits = 0;
+  memcpy(&bits, &value, sizeof(bits));
+  putU64(bits);
+  return true;
+}
+
+bool CFrameWriter::artifact(const char16_t* name, uint32_t length, uint64_t handle, uint64_t size)
+{
+  if (!begin(kFrameArtifact, textSize(length) + 16))
+  {
+    return false;
+  }
+  putText(name, length);
+  putU64(handle);
+  putU64(size);
+  return true;
+}
+
+bool CFrameWriter::caseEnd(uint32_t result, uint32_t ms)
+{
+  if (!begin(kFrameCaseEnd, 8))
+  {
+    return false;
+  }
+  putU32(result);
+  putU32(ms);
+  return true;
+}
+
+bool CFrameWriter::timing(const CaseTiming& timing)
+{
+  if (!begin(kFrameTiming, 48))
+  {
+    return false;
+  }
+  putU64(timing.hostStart);
+  putU64(timing.load);
+  putU64(timing.lookup);
+  putU64(timing.setup);
+  putU64(timing.run);
+  putU64(timing.teardown);
+  return true;
+}
+
+// Bounds-checked cursor over one frame body.
+class CBodyReader
+{
+public:
+  CBodyReader(const uint8_t* data, size_t size)
+    : m_data(data)
+    , m_size(size)
+    , m_pos(0)
+    , m_bError(false)
+  {
+  }
+
+  uint32_t u32()
+  {
+    uint32_t value = 0;
+    if (take(sizeof(value)))
+    {
+      memcpy(&value, m_data + m_pos - sizeof(value), sizeof(value));
+    }
+    return value;
+  }
+
+  uint64_t u64()
+  {
+    uint64_t value = 0;
+    if (take(sizeof(value)))
+    {
+      memcpy(&value, m_data + m_pos - sizeof(value), sizeof(value));
+    }
+    return value;
+  }
+
+  FrameText text()
+  {
+    FrameText text = { u"", 0 };
+    uint32_t length = u32();
+    if (m_bError || length > (m_size - m_pos) / sizeof(char16_t))
+    {
+      m_bError = true;
+      return text;
+    }
+
+    size_t size = textSize(length) - sizeof(uint32_t);
+    const uint8_t* data = m_data + m_pos;
+    if (take(size))
+    {
+      text.data = (const char16_t*)data;
+      text.length = length;
+    }
+    return text;
+  }
+
+  bool error() const
+  {
+    return m_bError;
+  }
+
+private:
+  bool take(size_t size)
+  {
+    if (m_bError || m_size - m_pos < size)
+    {
+      m_bError = true;
+      return false;
+    }
+    m_pos += size;
+    return true;
+  }
+
+private:
+  const uint8_t* m_data;
+  size_t m_size;
+  size_t m_pos;
+  bool m_bError;
+};
+
+CFrameReader::CFrameReader(const void* data, size_t size)
+  : m_data((const uint8_t*)data)
+  , m_size(size)
+  , m_pos(0)
+  , m_bError(false)
+{
+}
+
+bool CFrameReader::error() const
+{
+  return m_bError;
+}
+
+bool CFrameReader::next(Frame& frame)
+{
+  while (!m_bError && m_pos < m_size)
+  {
+    if (m_size - m_pos < kHeaderSize)
+    {
+      m_bError = true;
+      return false;
+    }
+
+    const uint8_t* header = m_data + m_pos;
+    uint32_t length = 0;
+    memcpy(&length, header + 4, sizeof(length));
+    if (header[0] != kProtocolVersion || (length & 3) != 0 ||
+      length > m_size - m_pos - kHeaderSize)
+    {
+      m_bError = true;
+      return false;
+    }
+
+    const uint8_t* body = header + kHeaderSize;
+    m_pos += kHeaderSize + length;
+
+    memset(&frame, 0, sizeof(frame));
+    frame.text.data = frame.file.data = u"";
+    CBodyReader reader(body, length);
+    switch (header[1])
+    {
+    case kFrameCaseStart:
+      frame.text = reader.text();
+      frame.id = reader.u64();
+      break;
+    case kFrameAssert:
+      frame.text = reader.text();
+      frame.file = reader.text();
+      frame.line = reader.u32();
+      break;
+    case kFrameLog:
+      frame.text = reader.text();
+      frame.level = reader.u32();
+      break;
+    case kFrameMetric:
+    {
+      frame.text = reader.text();
+      uint64_t bits = reader.u64();
+      memcpy(&frame.value, &bits, sizeof(bits));
+      break;
+    }
+    case kFrameArtifact:
+      frame.text = reader.text();
+      frame.handle = reader.u64();
+      frame.size = reader.u64();
+      break;
+    case kFrameCaseEnd:
+      frame.result = reader.u32();
+      frame.ms = reader.u32();
+      break;
+    case kFrameTiming:
+      frame.timing.hostStart = reader.u64();
+      frame.timing.load = reader.u64();
+      frame.timing.lookup = reader.u64();
+      frame.timing.setup = reader.u64();
+      frame.timing.run = reader.u64();
+      frame.timing.teardown = reader.u64();
+      break;
+    default:
+      // Newer record type: skip it.
+      continue;
+    }
+
+    if (reader.error())
+    {
+      m_bError = true;
+      return false;
+    }
+    frame.type = (FrameType)header[1];
+    return true;
+  }
+  return false;
+}
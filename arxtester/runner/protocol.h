@@ -0,0 +1,138 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Binary records exchanged between the runner and the loader. A message
+// on a ring carries one or more frames:
+//
+//   uint8  version   kProtocolVersion
+//   uint8  type      FrameType
+//   uint16 flags     0
+//   uint32 length    of the body, a multiple of 4
+//   body             fields of the type, in the order of Frame below
+//
+// Numbers are little-endian, text is a uint32 count of UTF-16 units
+// followed by the units, padded to 4 bytes. A reader skips frame types it
+// does not know, so records can be added without bumping the version.
+static const uint8_t kProtocolVersion = 3;
+
+enum FrameType
+{
+  kFrameCaseStart = 1,  // text: arx file, id: arxCaseId(); a queue entry
+  kFrameAssert,         // text: message, file, line
+  kFrameLog,            // text, level
+  kFrameMetric,         // text: name, value
+  kFrameArtifact,       // text: name, handle, size
+  kFrameCaseEnd,        // result (CaseEndResult), ms
+  kFrameTiming,         // timing; sent with the case end
+};
+
+enum CaseEndResult
+{
+  kCaseEndFail = 0,
+  kCaseEndPass,
+  // The case raised a hardware exception that the loader contained; the
+  // host lives on.
+  kCaseEndFault,
+};
+
+// Same values as CDebuger::MessageLevel.
+enum LogLevel
+{
+  kLogInfo = 0,
+  kLogDebug,
+  kLogWarning,
+  kLogError,
+};
+
+// Where the wall time of a case went, in microseconds, as measured by
+// the loader with QueryPerformanceCounter. hostStart is the time from the
+// creation of the host process until it was ready for cases; only the
+// first case of a host carries it, later ones have 0.
+struct CaseTiming
+{
+  uint64_t hostStart;
+  uint64_t load;       // module load, or the residency check
+  uint64_t lookup;     // finding the case in the module
+  uint64_t setup;      // side database and rollback transaction
+  uint64_t run;        // IArxCase::run()
+  uint64_t teardown;   // rollback, open object check, side database
+};
+
+struct FrameText
+{
+  const char16_t* data;
+  uint32_t length;
+};
+
+// A decoded frame. Text fields point into the decoded buffer.
+struct Frame
+{
+  FrameType type;
+  FrameText text;
+  FrameText file;
+  uint32_t line;
+  uint32_t level;
+  double value;
+  uint64_t handle;
+  uint64_t size;
+  uint32_t result;
+  uint32_t ms;
+  uint64_t id;
+  CaseTiming timing;
+};
+
+// Encodes frames into a caller-supplied buffer; never allocates. A frame
+// that does not fit is not written at all and the call returns false.
+class CFrameWriter
+{
+public:
+  CFrameWriter(void* buf, size_t capacity);
+
+  bool caseStart(const char16_t* arx, uint32_t length, uint64_t id);
+  bool assertion(const char16_t* message, uint32_t length,
+    const char16_t* file, uint32_t fileLength, uint32_t line);
+  bool log(uint32_t level, const char16_t* text, uint32_t length);
+  bool metric(const char16_t* name, uint32_t length, double value);
+  bool artifact(const char16_t* name, uint32_t length, uint64_t handle, uint64_t size);
+  bool caseEnd(uint32_t result, uint32_t ms);
+  bool timing(const CaseTiming& timing);
+
+  const void* data() const;
+  size_t size() const;
+  void clear();
+
+private:
+  bool begin(FrameType type, size_t body);
+  void putU32(uint32_t value);
+  void putU64(uint64_t value);
+  void putText(const char16_t* text, uint32_t length);
+
+private:
+  uint8_t* m_buf;
+  size_t m_capacity;
+  size_t m_size;
+};
+
+// Walks the frames of a message in place. Malformed input ends the walk
+// with error() set; it is never read past its end.
+class CFrameReader
+{
+public:
+  CFrameReader(const void* data, size_t size);
+
+  bool next(Frame& frame);
+  bool error() const;
+
+private:
+  const uint8_t* m_data;
+  size_t m_size;
+  size_t m_pos;
+  bool m_bError;
+};
+
+size_t textSize(uint32_t length);
+
+#endif//PROTOCOL_H
@@ -0,0 +1,207 @@
+#include "pch.h"
+#include "results.h"
+
+static const wchar_t* resultNames[] =
+{
+  L"success",
+  L"fail",
+  L"crash",
+  L"error",
+  L"cancel",
+  L"timeout",
+};
+
+const wchar_t* resultName(CaseResult result)
+{
+  return resultNames[result];
+}
+
+bool parseResultName(const wchar_t* name, CaseResult& result)
+{
+  for (int i = 0; i < _countof(resultNames); i++)
+  {
+    if (wcscmp(resultNames[i], name) == 0)
+    {
+      result = (CaseResult)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+CResultLog::CResultLog()
+  : m_bStop(false)
+  , m_file(nullptr)
+{
+}
+
+CResultLog::~CResultLog()
+{
+  close();
+}
+
+bool CResultLog::open(const CString& path)
+{
+  close();
+  m_file = _wfopen(path, L"wb");
+  if (m_file == nullptr)
+  {
+    return false;
+  }
+
+  m_bStop = false;
+  m_thread = std::thread(&CResultLog::writer, this);
+  return true;
+}
+
+void CResultLog::close()
+{
+  if (m_thread.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_bStop = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+  }
+
+  if (m_file)
+  {
+    fclose(m_file);
+    m_file = nullptr;
+  }
+}
+
+void CResultLog::write(const CString& key, CaseResult result, DWORD ms)
+{
+  CString line;
+  line.Format(L"%s\t%u\t%s", resultName(result), ms, (LPCTSTR)key);
+  writeLine(line);
+}
+
+void CResultLog::comment(const CString& text)
+{
+  writeLine(L"# " + text);
+}
+
+void CResultLog::writeLine(const CString& line)
+{
+  CStringA utf8 = CW2A(line + L"\n", CP_UTF8);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file == nullptr)
+    {
+      return;
+    }
+    m_queue.append((LPCSTR)utf8, utf8.GetLength());
+  }
+  m_cv.notify_one();
+}
+
+void CResultLog::writer()
+{
+  std::string batch;
+  for (;;)
+  {
+    bool bStop = false;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this] { return m_bStop || !m_queue.empty(); });
+      batch.swap(m_queue);
+      bStop = m_bStop;
+    }
+
+    if (!batch.empty())
+    {
+      fwrite(batch.data(), 1, batch.size(), m_file);
+      fflush(m_file);
+      batch.clear();
+    }
+    else if (bStop)
+    {
+      break;
+    }
+  }
+}
+
+struct ResultLine
+{
+  CaseResult result;
+  DWORD ms;
+};
+
+static bool readResults(const CString& path, std::map<std::wstring, ResultLine>& results)
+{
+  FILE* file = _wfopen(path, L"rb");
+  if (file == nullptr)
+  {
+    return false;
+  }
+
+  char buf[4096];
+  while (fgets(buf, sizeof(buf), file))
+  {
+    CString line = CA2W(buf, CP_UTF8);
+    line.TrimRight(L"\r\n");
+    if (line.IsEmpty() || line[0] == L'#')
+    {
+      continue;
+    }
+
+    int first = line.Find(L'\t');
+    int second = first == -1 ? -1 : line.Find(L'\t', first + 1);
+    CaseResult result;
+    if (second == -1 || !parseResultName(line.Left(first), result))
+    {
+      continue;
+    }
+
+    ResultLine& it = results[(LPCTSTR)line.Mid(second + 1)];
+    it.result = result;
+    it.ms = wcstoul(line.Mid(first + 1, second - first - 1), nullptr, 10);
+  }
+
+  fclose(file);
+  return true;
+}
+
+bool mergeResults(const CStringArray& inputs, const CString& output)
+{
+  std::map<std::wstring, ResultLine> results;
+  for (int i = 0; i < inputs.GetCount(); i++)
+  {
+    if (!readResults(inputs.GetAt(i), results))
+    {
+      return false;
+    }
+  }
+
+  CResultLog log;
+  if (!log.open(output))
+  {
+    return false;
+  }
+
+  int counts[_countof(resultNames)] = { 0 };
+  ULONGLONG total = 0;
+  for (auto& it : results)
+  {
+    log.write(it.first.c_str(), it.second.result, it.second.ms);
+    counts[it.second.result]++;
+    total += it.second.ms;
+  }
+
+  CString str;
+  str.Format(L"merged %d files, %d cases, %I64u ms", (int)inputs.GetCount(), (int)results.size(), total);
+  log.comment(str);
+  for (int i = 0; i < _countof(resultNames); i++)
+  {
+    if (counts[i])
+    {
+      str.Format(L"%s: %d", resultNames[i], counts[i]);
+      log.comment(str);
+    }
+  }
+  return true;
+}
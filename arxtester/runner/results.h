@@ -0,0 +1,41 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include "hostpool.h"
+
+const wchar_t* resultName(CaseResult result);
+bool parseResultName(const wchar_t* name, CaseResult& result);
+
+// Result file of a run, one "<result>\t<ms>\t<arx:case>" line per case,
+// written as the results arrive. Lines starting with '#' are comments.
+// Lines are queued and written in batches by a thread of the log's own,
+// so a chatty case never waits for the disk; close() writes out the rest.
+class CResultLog
+{
+public:
+  CResultLog();
+  ~CResultLog();
+
+  bool open(const CString& path);
+  void close();
+  void write(const CString& key, CaseResult result, DWORD ms);
+  void comment(const CString& text);
+
+private:
+  void writeLine(const CString& line);
+  void writer();
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::string m_queue;
+  bool m_bStop;
+  std::thread m_thread;
+  FILE* m_file;
+};
+
+// Combines the result files of several shards into one report, sorted by
+// case and followed by a summary.
+bool mergeResults(const CStringArray& inputs, const CString& output);
+
+#endif//RESULTS_H
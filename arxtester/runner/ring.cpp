@@ -0,0 +1,261 @@
+#include "ring.h"
+
+#include <cstring>
+#include <new>
+
+static const uint32_t kRingMagic = 0x52525841;  // "AXRR"
+static const uint32_t kRingVersion = 1;
+// Size field of the marker that sends the reader back to offset 0.
+static const uint32_t kWrap = 0xffffffff;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+  "the ring needs lock-free 64-bit atomics to be shared between processes");
+
+static uint32_t recordSize(uint32_t size)
+{
+  return (uint32_t)((sizeof(uint32_t) + (uint64_t)size + 7) & ~(uint64_t)7);
+}
+
+CRingBuffer::CRingBuffer()
+  : m_header(nullptr)
+  , m_data(nullptr)
+  , m_mask(0)
+  , m_pending(0)
+{
+}
+
+uint32_t CRingBuffer::roundCapacity(uint32_t capacity)
+{
+  uint32_t rounded = kMinCapacity;
+  while (rounded < capacity && rounded < kMaxCapacity)
+  {
+    rounded <<= 1;
+  }
+  return rounded;
+}
+
+size_t CRingBuffer::mappingSize(uint32_t capacity)
+{
+  return sizeof(RingHeader) + roundCapacity(capacity);
+}
+
+bool CRingBuffer::create(void* mem, uint32_t capacity)
+{
+  detach();
+  if (!mem)
+  {
+    return false;
+  }
+
+  capacity = roundCapacity(capacity);
+  memset(mem, 0, sizeof(RingHeader));
+  RingHeader* header = new (mem) RingHeader;
+  header->magic = kRingMagic;
+  header->version = kRingVersion;
+  header->capacity = capacity;
+  header->head.store(0);
+  header->tail.store(0);
+  header->readerWaiting.store(0);
+  header->writerWaiting.store(0);
+
+  m_header = header;
+  m_data = (uint8_t*)mem + sizeof(RingHeader);
+  m_mask = capacity - 1;
+  return true;
+}
+
+bool CRingBuffer::attach(void* mem, size_t size)
+{
+  detach();
+  if (!mem || size < sizeof(RingHeader))
+  {
+    return false;
+  }
+
+  RingHeader* header = (RingHeader*)mem;
+  uint32_t capacity = header->capacity;
+  if (header->magic != kRingMagic || header->version != kRingVersion ||
+    capacity < kMinCapacity || capacity > kMaxCapacity ||
+    (capacity & (capacity - 1)) != 0 ||
+    size - sizeof(RingHeader) < capacity)
+  {
+    return false;
+  }
+
+  m_header = header;
+  m_data = (uint8_t*)mem + sizeof(RingHeader);
+  m_mask = capacity - 1;
+  return true;
+}
+
+void CRingBuffer::detach()
+{
+  m_header = nullptr;
+  m_data = nullptr;
+  m_mask = 0;
+  m_pending = 0;
+}
+
+bool CRingBuffer::isValid() const
+{
+  return m_header != nullptr;
+}
+
+uint32_t CRingBuffer::capacity() const
+{
+  return m_header ? m_mask + 1 : 0;
+}
+
+uint32_t CRingBuffer::maxMessage() const
+{
+  // Half the ring, so that a message plus the wrap marker in front of it
+  // always fits once the reader has caught up.
+  return m_header ? (m_mask + 1) / 2 - sizeof(uint32_t) : 0;
+}
+
+bool CRingBuffer::fits(uint64_t head, uint64_t tail, uint32_t size) const
+{
+  uint32_t capacity = m_mask + 1;
+  if (head < tail || head - tail > capacity)
+  {
+    return false;
+  }
+
+  uint32_t need = recordSize(size);
+  uint32_t toEnd = capacity - (uint32_t)(head & m_mask);
+  uint64_t total = toEnd < need ? toEnd + need : need;
+  return head - tail + total <= capacity;
+}
+
+bool CRingBuffer::write(const void* data, uint32_t size, bool& bWake)
+{
+  bWake = false;
+  if (!m_header || size > maxMessage())
+  {
+    return false;
+  }
+
+  uint64_t head = m_header->head.load(std::memory_order_relaxed);
+  uint64_t tail = m_header->tail.load(std::memory_order_acquire);
+  if (!fits(head, tail, size))
+  {
+    return false;
+  }
+
+  uint32_t need = recordSize(size);
+  uint32_t offset = (uint32_t)(head & m_mask);
+  uint32_t toEnd = m_mask + 1 - offset;
+  if (toEnd < need)
+  {
+    *(uint32_t*)(m_data + offset) = kWrap;
+    head += toEnd;
+    offset = 0;
+  }
+  *(uint32_t*)(m_data + offset) = size;
+  if (size)
+  {
+    memcpy(m_data + offset + sizeof(uint32_t), data, size);
+  }
+
+  // Publishing head and checking the flag pair up with prepareReadWait()
+  // storing the flag and checking head, so a wakeup is never lost.
+  m_header->head.store(head + need, std::memory_order_seq_cst);
+  bWake = m_header->readerWaiting.load(std::memory_order_seq_cst) != 0 &&
+    m_header->readerWaiting.exchange(0) != 0;
+  return true;
+}
+
+bool CRingBuffer::prepareWriteWait(uint32_t size)
+{
+  if (!m_header || size > maxMessage())
+  {
+    return false;
+  }
+
+  m_header->writerWaiting.store(1, std::memory_order_seq_cst);
+  uint64_t head = m_header->head.load(std::memory_order_relaxed);
+  uint64_t tail = m_header->tail.load(std::memory_order_seq_cst);
+  if (fits(head, tail, size))
+  {
+    m_header->writerWaiting.store(0);
+    return false;
+  }
+  return true;
+}
+
+bool CRingBuffer::peek(const void*& data, uint32_t& size)
+{
+  if (!m_header)
+  {
+    return false;
+  }
+
+  uint32_t capacity = m_mask + 1;
+  uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+  uint64_t head = m_header->head.load(std::memory_order_acquire);
+  for (;;)
+  {
+    if (head == tail || head < tail || head - tail > capacity)
+    {
+      return false;
+    }
+
+    uint32_t offset = (uint32_t)(tail & m_mask);
+    uint32_t recorded = *(volatile uint32_t*)(m_data + offset);
+    if (recorded == kWrap)
+    {
+      tail += capacity - offset;
+      m_header->tail.store(tail, std::memory_order_release);
+      continue;
+    }
+
+    uint32_t need = recordSize(recorded);
+    if (recorded > maxMessage() || need > capacity - offset || need > head - tail)
+    {
+      return false;
+    }
+
+    data = m_data + offset + sizeof(uint32_t);
+    size = recorded;
+    m_pending = need;
+    return true;
+  }
+}
+
+void CRingBuffer::consume(bool& bWake)
+{
+  bWake = false;
+  if (!m_header || !m_pending)
+  {
+    return;
+  }
+
+  uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+  m_header->tail.store(tail + m_pending, std::memory_order_seq_cst);
+  m_pending = 0;
+  bWake = m_header->writerWaiting.load(std::memory_order_seq_cst) != 0 &&
+    m_header->writerWaiting.exchange(0) != 0;
+}
+
+bool CRingBuffer::prepareReadWait()
+{
+  if (!m_header)
+  {
+    return false;
+  }
+
+  m_header->readerWaiting.store(1, std::memory_order_seq_cst);
+  if (!empty())
+  {
+    m_header->readerWaiting.store(0);
+    return false;
+  }
+  return true;
+}
+
+bool CRingBuffer::empty() const
+{
+  return !m_header ||
+    m_header->head.load(std::memory_order_seq_cst) ==
+    m_header->tail.load(std::memory_order_relaxed);
+}
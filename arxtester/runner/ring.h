@@ -0,0 +1,86 @@
+#ifndef RING_H
+#define RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Control block at the start of a shared mapping, followed by `capacity`
+// bytes of ring data. head and tail only ever grow; the byte offset of a
+// position is position & (capacity - 1). Each side owns one position and
+// one waiting flag, on its own cache line.
+struct RingHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t capacity;
+  uint32_t reserved;
+
+  alignas(64) std::atomic<uint64_t> head;
+  std::atomic<uint32_t> readerWaiting;
+
+  alignas(64) std::atomic<uint64_t> tail;
+  std::atomic<uint32_t> writerWaiting;
+};
+
+// Bounded single-producer/single-consumer message ring over memory shared
+// by two processes. Messages are stored contiguously as a 32-bit size and
+// the payload, padded to 8 bytes; a message that does not fit before the
+// end of the data leaves a wrap marker and starts over at offset 0.
+//
+// Neither side trusts the other: every size and position read from the
+// mapping is checked against the capacity before it is used, so a
+// corrupted or hostile peer can make reads fail but never go out of bounds.
+//
+// The class itself never blocks. Before a side sleeps on its wakeup
+// primitive it announces it with prepareRead/WriteWait(); the other side
+// is told to signal it by the bWake out-parameter of write()/consume().
+class CRingBuffer
+{
+public:
+  static const uint32_t kMinCapacity = 4096;
+  static const uint32_t kMaxCapacity = 64 * 1024 * 1024;
+
+  CRingBuffer();
+
+  // The capacity a creator will actually use for a requested one: a power
+  // of two within [kMinCapacity, kMaxCapacity].
+  static uint32_t roundCapacity(uint32_t capacity);
+  static size_t mappingSize(uint32_t capacity);
+
+  // Creator: formats mem, which must be mappingSize(capacity) bytes.
+  bool create(void* mem, uint32_t capacity);
+  // Opener: validates the header written by the creator against the
+  // size of the view it actually mapped.
+  bool attach(void* mem, size_t size);
+  void detach();
+
+  bool isValid() const;
+  uint32_t capacity() const;
+  // Largest payload a single message can carry.
+  uint32_t maxMessage() const;
+
+  // Producer. Fails when the message is too large or there is no room.
+  bool write(const void* data, uint32_t size, bool& bWake);
+  // Returns false when room for size bytes appeared meanwhile and there is
+  // no need to wait.
+  bool prepareWriteWait(uint32_t size);
+
+  // Consumer. The message stays in place, and valid, until consume().
+  bool peek(const void*& data, uint32_t& size);
+  void consume(bool& bWake);
+  // Returns false when data arrived meanwhile and there is no need to wait.
+  bool prepareReadWait();
+  bool empty() const;
+
+private:
+  bool fits(uint64_t head, uint64_t tail, uint32_t size) const;
+
+private:
+  RingHeader* m_header;
+  uint8_t* m_data;
+  uint32_t m_mask;
+  uint32_t m_pending;
+};
+
+#endif//RING_H
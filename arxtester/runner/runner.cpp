@@ -6,6 +6,8 @@
 #include "runner.h"
 #include "configDlg.h"
 #include "runnerDlg.h"
+#include "results.h"
+#include "headless.h"
 
 
 // CArxRunnerApp
@@ -17,6 +19,7 @@ END_MESSAGE_MAP()
 // CArxRunnerApp 构造
 
 CArxRunnerApp::CArxRunnerApp()
+  : m_nExitCode(0)
 {
 }
 
@@ -31,6 +34,12 @@ public:
   CArxRunnerCommandLine()
   {
     bConfig = FALSE;
+    bRun = FALSE;
+    bFull = FALSE;
+    bResume = FALSE;
+    nShard = 0;
+    nShards = 0;
+    nBench = 0;
   }
   virtual void ParseParam(const TCHAR* pszParam, BOOL bFlag, BOOL bLast)
   {
@@ -38,9 +47,84 @@ public:
     {
       bConfig = TRUE;
     }
+    else if (bFlag && _wcsicmp(pszParam, L"run") == 0)
+    {
+      bRun = TRUE;
+    }
+    else if (bFlag && _wcsicmp(pszParam, L"full") == 0)
+    {
+      // Ignore the cached results of unchanged modules.
+      bFull = TRUE;
+    }
+    else if (bFlag && _wcsicmp(pszParam, L"resume") == 0)
+    {
+      // Skip what the journal of an interrupted run already finished.
+      bResume = TRUE;
+    }
+    else if (bFlag && _wcsnicmp(pszParam, L"suite:", 6) == 0)
+    {
+      bRun = TRUE;
+      strSuite = pszParam + 6;
+    }
+    else if (bFlag && _wcsnicmp(pszParam, L"out:", 4) == 0)
+    {
+      strOut = pszParam + 4;
+    }
+    else if (bFlag && _wcsnicmp(pszParam, L"shard:", 6) == 0)
+    {
+      // /shard:i/n, i in 1..n
+      int shard = 0, shards = 0, end = 0;
+      if (swscanf_s(pszParam + 6, L"%d/%d%n", &shard, &shards, &end) == 2 &&
+        !pszParam[6 + end] && shards > 0 && shard >= 1 && shard <= shards)
+      {
+        nShard = shard;
+        nShards = shards;
+      }
+      else
+      {
+        strBadShard = pszParam;
+      }
+    }
+    else if (bFlag && _wcsnicmp(pszParam, L"history:", 8) == 0)
+    {
+      // /history:<file>, the read-only wall times the shards are split by
+      strHistory = pszParam + 8;
+    }
+    else if (bFlag && _wcsnicmp(pszParam, L"bench:", 6) == 0)
+    {
+      // /bench:<cases> [/fakehost:"<options>"]
+      nBench = _wtoi(pszParam + 6);
+    }
+    else if (bFlag && _wcsnicmp(pszParam, L"fakehost:", 9) == 0)
+    {
+      strFakeHost = pszParam + 9;
+    }
+    else if (bFlag && _wcsnicmp(pszParam, L"merge:", 6) == 0)
+    {
+      // /merge:<output> <input>...
+      strMerge = pszParam + 6;
+    }
+    else if (!bFlag)
+    {
+      files.Add(pszParam);
+    }
   }
 
   BOOL bConfig;
+  BOOL bRun;
+  BOOL bFull;
+  BOOL bResume;
+  CString strSuite;
+  CString strOut;
+  int nShard;
+  int nShards;
+  // The /shard argument if it is not a valid i/n.
+  CString strBadShard;
+  CString strHistory;
+  CString strMerge;
+  int nBench;
+  CString strFakeHost;
+  CStringArray files;
 };
 
 BOOL CArxRunnerApp::InitInstance()
@@ -56,7 +140,32 @@ BOOL CArxRunnerApp::InitInstance()
   CArxRunnerCommandLine cmdInfo;
   ParseCommandLine(cmdInfo);
 
-  if (cmdInfo.bConfig)
+  // Running all cases, or another split, would run cases twice across
+  // the shards.
+  CString badShard;
+  if (!cmdInfo.strBadShard.IsEmpty())
+  {
+    badShard = L"/" + cmdInfo.strBadShard + L": expected /shard:i/n with i in 1..n";
+  }
+
+  if (!cmdInfo.strMerge.IsEmpty())
+  {
+    m_nExitCode = mergeResults(cmdInfo.files, cmdInfo.strMerge) ? kExitSuccess : kExitError;
+  }
+  else if (cmdInfo.nBench > 0)
+  {
+    m_nExitCode = runBench(cmdInfo.nBench, cmdInfo.strFakeHost);
+  }
+  else if (cmdInfo.bRun && !badShard.IsEmpty())
+  {
+    m_nExitCode = failHeadless(badShard);
+  }
+  else if (cmdInfo.bRun)
+  {
+    m_nExitCode = runHeadless(cmdInfo.strSuite, cmdInfo.strOut, cmdInfo.nShard,
+      cmdInfo.nShards, cmdInfo.strHistory, cmdInfo.bFull != FALSE, cmdInfo.bResume != FALSE);
+  }
+  else if (cmdInfo.bConfig)
   {
     CMutex m(TRUE, L"Arx runner - Config");
     if (m.m_hObject)
@@ -66,17 +175,33 @@ BOOL CArxRunnerApp::InitInstance()
       dlg.DoModal();
     }
   }
+  else if (!badShard.IsEmpty())
+  {
+    AfxMessageBox(badShard, MB_ICONERROR);
+    m_nExitCode = kExitError;
+  }
   else
   {
-    CMutex m(TRUE, L"Arx runner - Runner");
-    if (m.m_hObject)
+    // Any number of runners may be open; every run is its own session.
+    CRunnerDlg dlg;
+    if (!dlg.setShard(cmdInfo.nShard, cmdInfo.nShards, cmdInfo.strHistory))
     {
-      CRunnerDlg dlg;
-      m_pMainWnd = &dlg;
-      dlg.DoModal();
+      AfxMessageBox(L"无法读取 " + cmdInfo.strHistory, MB_ICONERROR);
+      m_nExitCode = kExitError;
+      return FALSE;
     }
+    dlg.setFull(cmdInfo.bFull != FALSE);
+    dlg.setResume(cmdInfo.bResume != FALSE);
+    m_pMainWnd = &dlg;
+    dlg.DoModal();
   }
 
 	return FALSE;
 }
 
+int CArxRunnerApp::ExitInstance()
+{
+  CWinApp::ExitInstance();
+  return m_nExitCode;
+}
+
@@ -23,6 +23,10 @@ public:
 // 重写
 public:
 	virtual BOOL InitInstance();
+	virtual int ExitInstance();
+
+	// Returned from the process by a headless run or a merge.
+	int m_nExitCode;
 
 // 实现
 
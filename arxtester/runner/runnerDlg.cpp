@@ -1,11 +1,13 @@
 ﻿#include "pch.h"
 #include "Resource.h"
-#include "config.h"
-#include "sharefile.h"
 #include "runnerDlg.h"
 
 #define WM_THREAD_MESSAGE (WM_USER + 1001)
 
+// The list takes the updates of the run thread in batches at this pace.
+#define UPDATE_TIMER    1
+#define UPDATE_INTERVAL 100
+
 CRunnerDlg::CRunnerDlg(CWnd* pParent /*=nullptr*/)
 	: CBaseDlg(CRunnerDlg::IDD, pParent)
   , m_hThread(nullptr)
@@ -14,6 +16,21 @@ CRunnerDlg::CRunnerDlg(CWnd* pParent /*=nullptr*/)
   SetDialogName(L"ArxRunner Runner Dialog");
 }
 
+bool CRunnerDlg::setShard(int shard, int shards, const CString& weightsFile)
+{
+  return m_suite.setShard(shard, shards, weightsFile);
+}
+
+void CRunnerDlg::setFull(bool bFull)
+{
+  m_suite.setFull(bFull);
+}
+
+void CRunnerDlg::setResume(bool bResume)
+{
+  m_suite.setResume(bResume);
+}
+
 void CRunnerDlg::DoDataExchange(CDataExchange* pDX)
 {
   CBaseDlg::DoDataExchange(pDX);
@@ -25,6 +42,7 @@ BEGIN_MESSAGE_MAP(CRunnerDlg, CBaseDlg)
   ON_BN_CLICKED(IDC_BUTTON_CONFIG, &CRunnerDlg::OnBnClickedButtonConfig)
   ON_BN_CLICKED(IDOK, &CRunnerDlg::OnBnClickedOk)
   ON_MESSAGE(WM_THREAD_MESSAGE, &CRunnerDlg::OnThreadMessage)
+  ON_WM_TIMER()
 END_MESSAGE_MAP()
 
 BOOL CRunnerDlg::OnInitDialog()
@@ -78,20 +96,28 @@ void CRunnerDlg::OnBnClickedButtonConfig()
   }
 }
 
+void CRunnerDlg::stopThread()
+{
+  SetEvent(m_hEvent);
+  WaitForSingleObject(m_hThread, INFINITE);
+  CloseHandle(m_hThread);
+  m_hThread = nullptr;
+
+  CloseHandle(m_hEvent);
+  m_hEvent = nullptr;
+
+  KillTimer(UPDATE_TIMER);
+  drainUpdates();
+
+  GetDlgItem(IDCANCEL)->EnableWindow(TRUE);
+  SetDlgItemText(IDOK, L"开始");
+}
+
 void CRunnerDlg::OnBnClickedOk()
 {
   if (m_hThread)
   {
-    SetEvent(m_hEvent);
-    WaitForSingleObject(m_hThread, INFINITE);
-    CloseHandle(m_hThread);
-    m_hThread = nullptr;
-
-    CloseHandle(m_hEvent);
-    m_hEvent = nullptr;
-
-    GetDlgItem(IDCANCEL)->EnableWindow(TRUE);
-    SetDlgItemText(IDOK, L"开始");
+    stopThread();
   }
   else
   {
@@ -99,7 +125,9 @@ void CRunnerDlg::OnBnClickedOk()
     SetDlgItemText(IDOK, L"停止");
 
     m_listLog.DeleteAllItems();
+    m_sLog = m_suite.newResultFile();
 
+    SetTimer(UPDATE_TIMER, UPDATE_INTERVAL, nullptr);
     m_hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
     DWORD id = 0;
     m_hThread = CreateThread(nullptr, 0,
@@ -116,160 +144,102 @@ int CRunnerDlg::threadProc(LPVOID param)
 
 #define WM_THREAD_FINISH  0
 #define WM_THREAD_CANCEL  1
-#define WM_THREAD_CASE    2
-#define WM_THREAD_SUCCESS 4
-#define WM_THREAD_FAIL    5
-#define WM_THREAD_CRASH   6
-#define WM_THREAD_ERROR   7
 
 void CRunnerDlg::run()
 {
-  std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-  std::time_t nowTime = std::chrono::system_clock::to_time_t(now);
-  std::wstringstream ss;
-  ss << std::put_time(std::localtime(&nowTime), L"%Y%m%d-%H%M%S");
-  m_sLog.Format(L"%sresult-%s.log", (LPCTSTR)appDir(), ss.str().c_str());
-
-  CConfig cfg;
-  CStringArray cases;
-  for (int i = 0; i < cfg.m_ac.moduleCount(); i++)
+  if (!m_suite.run(m_hEvent, this))
   {
-    IArxModule* m = cfg.m_ac.moduleAt(i);
-    for (int j = 0; j < m->caseCount(); j++)
-    {
-      IArxCase* c = m->caseAt(j);
-      if (c->isEnabled())
-      {
-        CString str;
-        str.Format(L"%s - [%s]", c->name(), m->moduleName());
-        SendMessage(WM_THREAD_MESSAGE, WM_THREAD_CASE, (LPARAM)(LPCTSTR)str);
-        
-        str.Format(L"%s:%s", m->arxName(), c->name());
-        cases.Add(str);
-      }
-    }
+    PostMessage(WM_THREAD_MESSAGE, WM_THREAD_CANCEL);
+    return;
   }
 
-  for (int i = 0; i < cases.GetCount(); i++)
+  PostMessage(WM_THREAD_MESSAGE, WM_THREAD_FINISH);
+}
+
+void CRunnerDlg::onCase(int index, const CString& name)
+{
+  Update update = { true, index, kCaseSuccess, name };
+  m_updates.push(std::move(update));
+}
+
+void CRunnerDlg::onCaseResult(int index, CaseResult result, uint32_t)
+{
+  Update update = { false, index, result, CString() };
+  m_updates.push(std::move(update));
+}
+
+void CRunnerDlg::OnTimer(UINT_PTR nIDEvent)
+{
+  if (nIDEvent == UPDATE_TIMER)
   {
-    const wchar_t strEvent[] = L"Global-Gstarcad Cases";
-    HANDLE hEvent = CreateEvent(nullptr, TRUE, FALSE, strEvent);
+    drainUpdates();
+    return;
+  }
 
-    CShareFile sf(strCaseName);
-    sf.writeLine(cases.GetAt(i));
+  CBaseDlg::OnTimer(nIDEvent);
+}
 
-    wchar_t strCmdLine[MAX_PATH * 2] = { 0 };
-    if (cfg.m_iGcad)
-    {
-    }
-    else
-    {
-      swprintf_s(strCmdLine, MAX_PATH * 2,
-        L"\"%sacad.exe\" /b \"%srunner.scr\"",
-        (LPCTSTR)getAutoCadInstallDir(),
-        (LPCTSTR)appDir());
-    }
-    HANDLE hInst = startProc(strCmdLine);
-    if (hInst)
+void CRunnerDlg::drainUpdates()
+{
+  m_batch.clear();
+  if (!m_updates.take(m_batch))
+  {
+    return;
+  }
+
+  // One repaint per batch instead of one per row.
+  m_listLog.SetRedraw(FALSE);
+  for (const Update& update : m_batch)
+  {
+    if (update.bCase)
     {
-      HANDLE handles[] = { m_hEvent, hEvent, hInst };
-      DWORD objId = WaitForMultipleObjects(3, handles, FALSE, INFINITE);
-      if (WAIT_OBJECT_0 == objId)
-      {
-        SetEvent(hEvent);
-        CloseHandle(hEvent);
-
-        if (WAIT_OBJECT_0 != WaitForSingleObject(hInst, 1000))
-        {
-          TerminateProcess(hInst, 0);
-        }
-
-        PostMessage(WM_THREAD_MESSAGE, WM_THREAD_CANCEL);
-        return;
-      }
-      else if (WAIT_OBJECT_0 + 1 == objId)
-      {
-        if (WAIT_OBJECT_0 != WaitForSingleObject(hInst, 1000))
-        {
-          TerminateProcess(hInst, 0);
-        }
-
-        sf.reset();
-        if (sf.readLine() == "1")
-        {
-          PostMessage(WM_THREAD_MESSAGE, WM_THREAD_SUCCESS, i);
-        }
-        else
-        {
-          PostMessage(WM_THREAD_MESSAGE, WM_THREAD_FAIL, i);
-        }
-      }
-      else if (WAIT_OBJECT_0 + 2 == objId)
-      {
-        PostMessage(WM_THREAD_MESSAGE, WM_THREAD_CRASH, i);
-      }
+      m_listLog.InsertItem(m_listLog.GetItemCount(), update.name);
+      continue;
     }
-    else
+
+    switch (update.result)
     {
-      PostMessage(WM_THREAD_MESSAGE, WM_THREAD_ERROR, i);
+    case kCaseSuccess:
+      m_listLog.SetItemText(update.index, 1, L"成功");
+      break;
+    case kCaseFail:
+      m_listLog.SetItemText(update.index, 1, L"失败");
+      break;
+    case kCaseCrash:
+      m_listLog.SetItemText(update.index, 1, L"崩溃");
+      break;
+    case kCaseTimeout:
+      m_listLog.SetItemText(update.index, 1, L"超时");
+      break;
+    default:
+      m_listLog.SetItemText(update.index, 1, L"错误");
+      break;
     }
-    CloseHandle(hEvent);
   }
-
-  PostMessage(WM_THREAD_MESSAGE, WM_THREAD_FINISH);
+  m_listLog.SetRedraw(TRUE);
+  m_listLog.Invalidate();
 }
 
-LRESULT CRunnerDlg::OnThreadMessage(WPARAM wp, LPARAM lp)
+LRESULT CRunnerDlg::OnThreadMessage(WPARAM wp, LPARAM)
 {
   switch (wp)
   {
-  case WM_THREAD_CASE:
-  {
-    m_listLog.InsertItem(m_listLog.GetItemCount(), (LPCTSTR)lp);
-    break;
-  }
   case WM_THREAD_FINISH:
   {
+    drainUpdates();
     m_listLog.InsertItem(m_listLog.GetItemCount(), L"完成");
     OnBnClickedOk();
     break;
   }
   case WM_THREAD_CANCEL:
   {
-    SetEvent(m_hEvent);
-    WaitForSingleObject(m_hThread, INFINITE);
-    CloseHandle(m_hThread);
-    m_hThread = nullptr;
-
-    CloseHandle(m_hEvent);
-    m_hEvent = nullptr;
-
-    GetDlgItem(IDCANCEL)->EnableWindow(TRUE);
-    SetDlgItemText(IDOK, L"开始");
-
+    if (m_hThread)
+    {
+      stopThread();
+    }
     m_listLog.InsertItem(m_listLog.GetItemCount(), L"取消");
     break;
   }
-  case WM_THREAD_SUCCESS:
-  {
-    m_listLog.SetItemText((int)lp, 1, L"成功");
-    break;
-  }
-  case WM_THREAD_FAIL:
-  {
-    m_listLog.SetItemText((int)lp, 1, L"失败");
-    break;
-  }
-  case WM_THREAD_CRASH:
-  {
-    m_listLog.SetItemText((int)lp, 1, L"崩溃");
-    break;
-  }
-  case WM_THREAD_ERROR:
-  {
-    m_listLog.SetItemText((int)lp, 1, L"错误");
-    break;
-  }
   default:
     break;
   }
@@ -1,14 +1,20 @@
 ﻿#pragma once
 
 #include "basedlg.h"
+#include "suite.h"
+#include "batchqueue.h"
 
-class CRunnerDlg : public CBaseDlg
+class CRunnerDlg : public CBaseDlg, public ISuiteSink
 {
 // 构造
 public:
 	CRunnerDlg(CWnd* pParent = nullptr);	// 标准构造函数
 	enum { IDD = IDD_ARXRUNNER_DIALOG };
 
+  bool setShard(int shard, int shards, const CString& weightsFile);
+  void setFull(bool bFull);
+  void setResume(bool bResume);
+
 	protected:
 	virtual void DoDataExchange(CDataExchange* pDX);	// DDX/DDV 支持
 
@@ -21,14 +27,32 @@ protected:
   afx_msg void OnBnClickedButtonConfig();
   afx_msg void OnBnClickedOk();
   afx_msg LRESULT OnThreadMessage(WPARAM wp, LPARAM lp);
+  afx_msg void OnTimer(UINT_PTR nIDEvent);
 	DECLARE_MESSAGE_MAP()
 
   static int threadProc(LPVOID param);
   void run();
+  virtual void onCase(int index, const CString& name);
+  virtual void onCaseResult(int index, CaseResult result, uint32_t ms);
+  void stopThread();
+  void drainUpdates();
 
 private:
+  // A list change posted by the run thread: a new row when bCase, else
+  // the result of row index.
+  struct Update
+  {
+    bool bCase;
+    int index;
+    CaseResult result;
+    CString name;
+  };
+
   CListCtrl m_listLog;
   CString m_sLog;
+  CSuite m_suite;
   HANDLE m_hThread;
   HANDLE m_hEvent;
+  CBatchQueue<Update> m_updates;
+  std::vector<Update> m_batch;
 };
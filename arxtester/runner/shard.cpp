@@ -0,0 +1,41 @@
+#include "pch.h"
+#include "history.h"
+#include "shard.h"
+
+std::vector<int> shardCases(const CStringArray& cases, const CCaseHistory* weights,
+  int shard, int shards)
+{
+  std::vector<int> order(cases.GetCount());
+  std::vector<DWORD> estimates(cases.GetCount());
+  for (int i = 0; i < cases.GetCount(); i++)
+  {
+    order[i] = i;
+    estimates[i] = weights ? weights->estimate((LPCTSTR)cases.GetAt(i)) : 1;
+  }
+
+  // Ties are broken by name rather than by discovery order, which follows
+  // the directory listing and may differ between machines.
+  std::sort(order.begin(), order.end(), [&](int a, int b)
+  {
+    if (estimates[a] != estimates[b])
+    {
+      return estimates[a] > estimates[b];
+    }
+    return cases.GetAt(a).Compare(cases.GetAt(b)) < 0;
+  });
+
+  std::vector<ULONGLONG> loads(shards, 0);
+  std::vector<int> mine;
+  for (int index : order)
+  {
+    int target = (int)(std::min_element(loads.begin(), loads.end()) - loads.begin());
+    loads[target] += estimates[index];
+    if (target == shard - 1)
+    {
+      mine.emplace_back(index);
+    }
+  }
+
+  std::sort(mine.begin(), mine.end());
+  return mine;
+}
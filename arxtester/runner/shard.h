@@ -0,0 +1,16 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+class CCaseHistory;
+
+// Indices of the cases that belong to shard `shard` (1-based) of `shards`.
+// The cases are dealt longest-first onto the least loaded shard by the
+// wall times in weights, or round-robin by name without weights.
+//
+// Every shard has to compute the same split, so weights must be the same
+// file on every machine, read-only for the run (/history:<file>); the
+// history.xml of a runner changes after every run and is never used here.
+std::vector<int> shardCases(const CStringArray& cases, const CCaseHistory* weights,
+  int shard, int shards);
+
+#endif//SHARD_H
@@ -1,111 +1,150 @@
-#include "pch.h"
-
+#include "ring.h"
+#include "status.h"
 #include "sharefile.h"
 
-typedef int(*GETLARGEPAGEMINIMUM)(void);
+#include <chrono>
+#include <cstring>
 
-static DWORD buf_size()
+std::wstring channelCaseName(const wchar_t* channel)
 {
-  static DWORD size = 0;
-  if (size == 0)
-  {
-    HINSTANCE hDll = LoadLibrary(L"kernel32.dll");
-    GETLARGEPAGEMINIMUM pGetLargePageMinimum = (GETLARGEPAGEMINIMUM)GetProcAddress(hDll,
-      "GetLargePageMinimum");
-    size = (*pGetLargePageMinimum)();
-    FreeLibrary(hDll);
-  }
+  return std::wstring(channel) + L"-Cases";
+}
+
+std::wstring channelStartName(const wchar_t* channel)
+{
+  return std::wstring(channel) + L"-Start";
+}
+
+std::wstring channelResultName(const wchar_t* channel)
+{
+  return std::wstring(channel) + L"-Results";
+}
 
-  return size;
+std::wstring channelStatusName(const wchar_t* channel)
+{
+  return std::wstring(channel) + L"-Status";
 }
 
 class CShareFileImpl
 {
-  HANDLE m_hFileMap;
-  wchar_t* m_lpFile;
-  wchar_t* m_lpBuf;
+  CIpcMemory m_memory;
+  CIpcEvent m_readable;
+  CIpcEvent m_writable;
 public:
-  CShareFileImpl(const wchar_t* szShareName, bool bOpen)
-    : m_lpFile(nullptr)
+  CRingBuffer ring;
+
+  CShareFileImpl(const wchar_t* szShareName, bool bOpen, uint32_t capacity)
   {
+    std::wstring name(szShareName);
+    if (bOpen ? !m_memory.open(szShareName) :
+      !m_memory.create(szShareName, (size_t)CRingBuffer::mappingSize(capacity)))
+    {
+      return;
+    }
+
+    // A host of a previous launch may still hold the mapping; the creator
+    // formats it afresh either way. The opener checks the header against
+    // what it could actually map.
     if (bOpen)
     {
-      m_hFileMap = OpenFileMapping(FILE_MAP_ALL_ACCESS, TRUE, szShareName);
+      if (ring.attach(m_memory.data(), m_memory.size()) && ring.capacity() < capacity)
+      {
+        ring.detach();
+      }
+      m_readable.open((name + L"-Readable").c_str(), false);
+      m_writable.open((name + L"-Writable").c_str(), false);
     }
     else
     {
-      m_hFileMap = CreateFileMapping(INVALID_HANDLE_VALUE, NULL,
-        PAGE_READWRITE, 0, buf_size(), szShareName);
+      ring.create(m_memory.data(), capacity);
+      m_readable.create((name + L"-Readable").c_str(), false);
+      m_writable.create((name + L"-Writable").c_str(), false);
     }
-    if (m_hFileMap == nullptr)
+  }
+
+  ~CShareFileImpl()
+  {
+    ring.detach();
+  }
+
+  bool isValid() const
+  {
+    return ring.isValid() && m_readable.isValid() && m_writable.isValid();
+  }
+
+  bool tryWrite(const void* data, uint32_t size)
+  {
+    bool bWake = false;
+    if (!ring.write(data, size, bWake))
     {
-      return;
+      return false;
     }
-
-    m_lpBuf = m_lpFile = (wchar_t*)MapViewOfFile(m_hFileMap, FILE_MAP_WRITE | FILE_MAP_READ, 0, 0, 0);
-    if (!bOpen && m_lpBuf)
+    if (bWake)
     {
-      m_lpBuf[0] = 0;
+      m_readable.set();
     }
+    return true;
   }
 
-  ~CShareFileImpl()
+  bool write(const void* data, uint32_t size, uint32_t timeout)
   {
-    if (m_lpFile)
+    if (size > ring.maxMessage())
     {
-      UnmapViewOfFile(m_lpFile);
-      m_lpFile = nullptr;
+      return false;
     }
 
-    if (m_hFileMap)
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    while (!tryWrite(data, size))
     {
-      CloseHandle(m_hFileMap);
-      m_hFileMap = nullptr;
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now()).count();
+      if (timeout != kIpcInfinite && left <= 0)
+      {
+        return false;
+      }
+      if (ring.prepareWriteWait(size))
+      {
+        m_writable.wait(timeout == kIpcInfinite ? kIpcInfinite : (uint32_t)left);
+      }
     }
+    return true;
   }
 
-  void reset()
+  void consume()
   {
-    m_lpBuf = m_lpFile;
+    bool bWake = false;
+    ring.consume(bWake);
+    if (bWake)
+    {
+      m_writable.set();
+    }
   }
 
-  void write(const CString& str)
+  bool waitReadable(uint32_t timeout)
   {
-    if (m_lpFile)
+    if (!ring.prepareReadWait())
     {
-      int len = str.GetLength() * sizeof(wchar_t);
-      memcpy_s(m_lpBuf, len + 1, (LPCTSTR)str, len);
-      m_lpBuf += str.GetLength();
-      m_lpBuf[0] = 0;
+      return isValid();
     }
+    return m_readable.wait(timeout);
   }
 
-  CString readLine()
+  bool armReadable()
   {
-    CString str;
-    if (m_lpFile)
-    {
-      wchar_t* pos = wcschr(m_lpBuf, L'\n');
-      if (pos == nullptr)
-      {
-        str = m_lpBuf;
-        m_lpBuf += wcslen(m_lpBuf);
-      }
-      else
-      {
-        size_t len = pos - m_lpBuf;
-        wchar_t* buf = str.GetBuffer((int)len + 1);
-        wcsncpy_s(buf, len + 1, m_lpBuf, len);
-        str.ReleaseBuffer();
-        m_lpBuf += len + 1;
-      }
-    }
-    return str;
+    // A stale signal would wake an event loop watch at once; a message it
+    // stood for is in the ring and is caught below.
+    m_readable.reset();
+    return ring.prepareReadWait();
+  }
+
+  LoopHandle readableEvent() const
+  {
+    return m_readable.handle();
   }
 };
 
-CShareFile::CShareFile(const CString& name, bool bOpen)
-  : m_impl(new CShareFileImpl(name, bOpen))
+CShareFile::CShareFile(const wchar_t* name, bool bOpen, uint32_t capacity)
+  : m_impl(new CShareFileImpl(name, bOpen, capacity))
 {
 }
 
@@ -114,17 +153,77 @@ CShareFile::~CShareFile()
   delete m_impl;
 }
 
-void CShareFile::reset()
+bool CShareFile::isValid() const
+{
+  return m_impl->isValid();
+}
+
+uint32_t CShareFile::maxMessage() const
+{
+  return m_impl->ring.maxMessage();
+}
+
+bool CShareFile::tryWrite(const void* data, uint32_t size)
+{
+  return m_impl->isValid() && m_impl->tryWrite(data, size);
+}
+
+bool CShareFile::write(const void* data, uint32_t size, uint32_t timeout)
+{
+  return m_impl->isValid() && m_impl->write(data, size, timeout);
+}
+
+bool CShareFile::peek(const void*& data, uint32_t& size)
+{
+  return m_impl->ring.peek(data, size);
+}
+
+void CShareFile::consume()
+{
+  m_impl->consume();
+}
+
+bool CShareFile::waitReadable(uint32_t timeout)
+{
+  return m_impl->isValid() && m_impl->waitReadable(timeout);
+}
+
+bool CShareFile::armReadable()
+{
+  return m_impl->armReadable();
+}
+
+LoopHandle CShareFile::readableEvent() const
 {
-  m_impl->reset();
+  return m_impl->readableEvent();
 }
 
-void CShareFile::writeLine(const CString& str)
+CShareStatus::CShareStatus(const wchar_t* name, bool bOpen)
+  : m_status(nullptr)
 {
-  m_impl->write(str);
+  if (bOpen ? !m_memory.open(name) : !m_memory.create(name, sizeof(HostStatus)))
+  {
+    return;
+  }
+  if (m_memory.size() < sizeof(HostStatus))
+  {
+    return;
+  }
+
+  m_status = (HostStatus*)m_memory.data();
+  if (!bOpen)
+  {
+    memset(m_memory.data(), 0, sizeof(HostStatus));
+    m_status->magic = kHostStatusMagic;
+    m_status->version = kHostStatusVersion;
+  }
+  else if (m_status->magic != kHostStatusMagic || m_status->version != kHostStatusVersion)
+  {
+    m_status = nullptr;
+  }
 }
 
-CString CShareFile::readLine()
+HostStatus* CShareStatus::get() const
 {
-  return m_impl->readLine();
-}
\ No newline at end of file
+  return m_status;
+}
@@ -1,23 +1,80 @@
 #ifndef SHAREFILE_H
 #define SHAREFILE_H
 
+#include <cstdint>
+#include <string>
+
+#include "eventloop.h"
+#include "ipc.h"
+
 class CShareFileImpl;
+struct HostStatus;
 
-const wchar_t strCaseName[] = L"Global-casesTobeTested";
+// The runner hands every host a channel name through this environment
+// variable; the case and result rings are derived from it.
+const wchar_t strChannelEnv[] = L"ARXTESTER_CHANNEL";
+// Process id of the runner, so a parked host can notice it is orphaned.
+const wchar_t strRunnerEnv[] = L"ARXTESTER_RUNNER";
+// Set to 1 when a host should hand in a minidump of every case fault.
+const wchar_t strMinidumpEnv[] = L"ARXTESTER_MINIDUMP";
 
+std::wstring channelCaseName(const wchar_t* channel);
+std::wstring channelStartName(const wchar_t* channel);
+std::wstring channelResultName(const wchar_t* channel);
+std::wstring channelStatusName(const wchar_t* channel);
+
+// One direction of a channel: a single-producer/single-consumer message
+// ring (see CRingBuffer) in a named mapping, plus a named auto-reset event
+// per side that the other side signals only when it announced a wait.
+// Both sit on the CIpc* layer, so the channel works on Windows and POSIX.
+//
+// The creator allocates `capacity` (rounded up to a power of two); for an
+// opener it is the minimum it accepts, and the channel is invalid when
+// the creator offered less.
 class CShareFile
 {
 public:
-  CShareFile(const CString& name, bool bOpen = false);
+  static const uint32_t kDefaultCapacity = 64 * 1024;
+
+  CShareFile(const wchar_t* name, bool bOpen = false, uint32_t capacity = kDefaultCapacity);
   ~CShareFile();
 
-  void reset();
-  void writeLine(const CString& str);
-  CString readLine();
+  bool isValid() const;
+  uint32_t maxMessage() const;
+
+  // Producer side.
+  bool tryWrite(const void* data, uint32_t size);
+  // Waits up to timeout ms for room.
+  bool write(const void* data, uint32_t size, uint32_t timeout);
+
+  // Consumer side. peek() exposes the next message in place; it stays
+  // valid until consume().
+  bool peek(const void*& data, uint32_t& size);
+  void consume();
+  // Waits up to timeout ms for a message.
+  bool waitReadable(uint32_t timeout);
+
+  // For a consumer that waits on readableEvent() itself: announces the
+  // wait, and returns false when a message arrived meanwhile.
+  bool armReadable();
+  LoopHandle readableEvent() const;
 
 private:
   CShareFileImpl* m_impl;
 };
 
+// The HostStatus block of a channel. The creator zeroes and stamps it; an
+// opener gets nullptr from get() unless the stamp matches.
+class CShareStatus
+{
+public:
+  CShareStatus(const wchar_t* name, bool bOpen = false);
+
+  HostStatus* get() const;
+
+private:
+  CIpcMemory m_memory;
+  HostStatus* m_status;
+};
 
-#endif//SHAREFILE_H
\ No newline at end of file
+#endif//SHAREFILE_H
@@ -0,0 +1,27 @@
+#ifndef STATUS_H
+#define STATUS_H
+
+#include <atomic>
+#include <cstdint>
+
+// Liveness of a host, in a mapping of its own next to the rings. The
+// loader bumps heartbeat on the thread that runs the cases, so it stops
+// when a case hangs that thread, and progress whenever a case calls
+// CDebuger::progress().
+// cases counts the cases the host has started. The runner only reads
+// those, and writes artifactsTaken: the number of artifact frames it has
+// dealt with, after which the host may close the sections behind them.
+struct HostStatus
+{
+  uint32_t magic;
+  uint32_t version;
+  std::atomic<uint64_t> heartbeat;
+  std::atomic<uint64_t> progress;
+  std::atomic<uint32_t> cases;
+  std::atomic<uint32_t> artifactsTaken;
+};
+
+static const uint32_t kHostStatusMagic = 0x53525841;  // "AXRS"
+static const uint32_t kHostStatusVersion = 2;
+
+#endif//STATUS_H
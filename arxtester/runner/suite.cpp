@@ -0,0 +1,352 @@
+#include "pch.h"
+#include "config.h"
+#include "history.h"
+#include "shard.h"
+#include "protocol.h"
+#include "suite.h"
+
+CSuite::CSuite()
+  : m_nShard(0)
+  , m_nShards(0)
+  , m_bFull(false)
+  , m_bResume(false)
+  , m_history(nullptr)
+  , m_sink(nullptr)
+{
+}
+
+CSuite::~CSuite()
+{
+}
+
+void CSuite::setSuiteFile(const CString& file)
+{
+  m_suiteFile = file;
+}
+
+bool CSuite::setShard(int shard, int shards, const CString& weightsFile)
+{
+  m_nShard = shard;
+  m_nShards = shards;
+  m_weights.reset();
+  if (!weightsFile.IsEmpty())
+  {
+    m_weights = std::make_unique<CCaseHistory>(weightsFile);
+    if (!m_weights->isLoaded())
+    {
+      m_weights.reset();
+      return false;
+    }
+  }
+  return true;
+}
+
+void CSuite::setFull(bool bFull)
+{
+  m_bFull = bFull;
+}
+
+void CSuite::setResume(bool bResume)
+{
+  m_bResume = bResume;
+}
+
+const CString& CSuite::newResultFile()
+{
+  m_session = newSessionId();
+  if (m_nShards > 0)
+  {
+    m_resultFile.Format(L"%sresult-%s-shard%dof%d.log", (LPCTSTR)appDir(),
+      (LPCTSTR)m_session, m_nShard, m_nShards);
+  }
+  else
+  {
+    m_resultFile.Format(L"%sresult-%s.log", (LPCTSTR)appDir(), (LPCTSTR)m_session);
+  }
+  return m_resultFile;
+}
+
+void CSuite::setResultFile(const CString& file)
+{
+  m_resultFile = file;
+}
+
+const CString& CSuite::resultFile() const
+{
+  return m_resultFile;
+}
+
+const CString& CSuite::caseKey(int index) const
+{
+  return m_cases.GetAt(index);
+}
+
+CString CSuite::journalFile() const
+{
+  CString name = L"journal";
+  if (!m_suiteFile.IsEmpty())
+  {
+    CString suite = m_suiteFile.Mid(m_suiteFile.ReverseFind(L'\\') + 1);
+    int dot = suite.ReverseFind(L'.');
+    name += L"-" + (dot > 0 ? suite.Left(dot) : suite);
+  }
+  if (m_nShards > 0)
+  {
+    CString shard;
+    shard.Format(L"-shard%dof%d", m_nShard, m_nShards);
+    name += shard;
+  }
+  return appDir() + name + L".log";
+}
+
+void CSuite::reuseResult(int index, CaseResult result, DWORD ms)
+{
+  m_results.write(m_cases.GetAt(index), result, ms);
+  m_sink->onCaseResult(index, result, ms);
+}
+
+bool CSuite::run(HANDLE hCancel, ISuiteSink* sink)
+{
+  m_sink = sink;
+  if (m_resultFile.IsEmpty())
+  {
+    newResultFile();
+  }
+  else if (m_session.IsEmpty())
+  {
+    m_session = newSessionId();
+  }
+
+  CConfig cfg(m_suiteFile);
+  CCaseHistory history;
+  m_history = &history;
+
+  CString host = fileVersion(getAutoCadInstallDir() + L"acad.exe");
+  CStringArray names, cases, fingerprints;
+  for (int i = 0; i < cfg.m_ac.moduleCount(); i++)
+  {
+    IArxModule* m = cfg.m_ac.moduleAt(i);
+    CString fingerprint;
+    if (!cfg.m_ac.moduleHash(i).IsEmpty())
+    {
+      fingerprint = cfg.m_ac.moduleHash(i) + L"-" + host;
+    }
+    for (int j = 0; j < m->caseCount(); j++)
+    {
+      IArxCase* c = m->caseAt(j);
+      if (c->isEnabled())
+      {
+        CString str;
+        str.Format(L"%s - [%s]", c->name(), m->moduleName());
+        names.Add(str);
+
+        str.Format(L"%s:%s", m->arxName(), c->name());
+        cases.Add(str);
+        fingerprints.Add(fingerprint);
+      }
+    }
+  }
+
+  m_cases.RemoveAll();
+  m_fingerprints.RemoveAll();
+  std::vector<int> indices;
+  if (m_nShards > 0)
+  {
+    indices = shardCases(cases, m_weights.get(), m_nShard, m_nShards);
+  }
+  else
+  {
+    for (int i = 0; i < cases.GetCount(); i++)
+    {
+      indices.emplace_back(i);
+    }
+  }
+  for (int i : indices)
+  {
+    m_sink->onCase((int)m_cases.GetCount(), names.GetAt(i));
+    m_cases.Add(cases.GetAt(i));
+    m_fingerprints.Add(fingerprints.GetAt(i));
+  }
+
+  m_results.open(m_resultFile);
+  m_results.comment(L"session " + m_session);
+
+  // Another runner on the same suite and shard owns the journal; this
+  // run still goes ahead, it just cannot be resumed.
+  JournalResults done;
+  if (!m_journal.open(journalFile(), m_bResume, done) && m_journal.isBusy())
+  {
+    m_results.comment(L"journal in use by another runner, this run cannot be resumed: " +
+      journalFile());
+  }
+
+  // Only the cases without a reusable result go to the hosts.
+  bool bIncremental = cfg.m_iIncremental && !m_bFull;
+  std::vector<std::wstring> pending;
+  m_pending.clear();
+  int resumed = 0, reused = 0;
+  for (int i = 0; i < m_cases.GetCount(); i++)
+  {
+    CaseResult result = kCaseSuccess;
+    DWORD ms = 0;
+    auto it = done.find((LPCTSTR)m_cases.GetAt(i));
+    if (it != done.end())
+    {
+      reuseResult(i, it->second.result, it->second.ms);
+      resumed++;
+    }
+    else if (bIncremental && !m_fingerprints.GetAt(i).IsEmpty() &&
+      history.lastResult(m_cases.GetAt(i), m_fingerprints.GetAt(i), result, ms))
+    {
+      m_journal.finish(m_cases.GetAt(i), result, ms);
+      reuseResult(i, result, ms);
+      reused++;
+    }
+    else
+    {
+      m_pending.emplace_back(i);
+      pending.emplace_back((LPCTSTR)m_cases.GetAt(i));
+    }
+  }
+  if (resumed)
+  {
+    CString str;
+    str.Format(L"%d of %d cases resumed from %s", resumed, (int)m_cases.GetCount(),
+      (LPCTSTR)journalFile());
+    m_results.comment(str);
+  }
+  if (reused)
+  {
+    CString str;
+    str.Format(L"%d of %d cases unchanged, results reused", reused, (int)m_cases.GetCount());
+    m_results.comment(str);
+  }
+
+  wchar_t strCmdLine[MAX_PATH * 2] = { 0 };
+  if (cfg.m_iGcad)
+  {
+  }
+  else
+  {
+    swprintf_s(strCmdLine, MAX_PATH * 2,
+      L"\"%sacad.exe\" /b \"%srunner.scr\"",
+      (LPCTSTR)getAutoCadInstallDir(),
+      (LPCTSTR)appDir());
+  }
+
+  CHostPool pool(strCmdLine, (LPCTSTR)m_session, cfg.poolOptions(), hCancel);
+  bool bFinished = pool.run(pending, history, this);
+  history.save();
+  m_history = nullptr;
+  m_journal.close(bFinished);
+  m_results.close();
+  return bFinished;
+}
+
+void CSuite::onCaseStart(int pending)
+{
+  m_journal.start(m_cases.GetAt(m_pending[pending]));
+}
+
+void CSuite::onCaseLog(int pending, const std::wstring& lines)
+{
+  const CString& key = m_cases.GetAt(m_pending[pending]);
+  CString text(lines.c_str());
+  int pos = 0;
+  CString line = text.Tokenize(L"\r\n", pos);
+  while (pos != -1)
+  {
+    line.Trim();
+    if (!line.IsEmpty())
+    {
+      m_results.comment(key + L": " + line);
+    }
+    line = text.Tokenize(L"\r\n", pos);
+  }
+}
+
+// Keeps `name` a single path component.
+static CString fileName(const CString& name)
+{
+  CString str(name);
+  for (int i = 0; i < str.GetLength(); i++)
+  {
+    if (wcschr(L"\\/:*?\"<>|", str[i]) || str[i] < L' ')
+    {
+      str.SetAt(i, L'_');
+    }
+  }
+  return str == L"." || str == L".." ? CString(L"_") : str;
+}
+
+void CSuite::onCaseArtifact(int pending, const std::wstring& name, const void* data,
+  uint64_t size)
+{
+  const CString& key = m_cases.GetAt(m_pending[pending]);
+  int dot = m_resultFile.ReverseFind(L'.');
+  CString path = (dot > m_resultFile.ReverseFind(L'\\') ? m_resultFile.Left(dot) : m_resultFile) +
+    L"-artifacts\\";
+  CreateDirectory(path, nullptr);
+  path += fileName(key) + L"\\";
+  CreateDirectory(path, nullptr);
+  path += fileName(CString(name.c_str()));
+
+  // Straight from the section to the file, in one write unless it is
+  // over 4GB.
+  bool bWritten = false;
+  HANDLE hFile = CreateFile(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+    FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (hFile != INVALID_HANDLE_VALUE)
+  {
+    const BYTE* pos = (const BYTE*)data;
+    uint64_t left = size;
+    bWritten = true;
+    while (bWritten && left)
+    {
+      DWORD chunk = (DWORD)(std::min)(left, (uint64_t)0x80000000);
+      DWORD written = 0;
+      bWritten = WriteFile(hFile, pos, chunk, &written, nullptr) && written == chunk;
+      pos += chunk;
+      left -= chunk;
+    }
+    CloseHandle(hFile);
+  }
+
+  CString str;
+  str.Format(bWritten ? L"artifact %s (%I64u bytes)" : L"error: cannot save artifact %s",
+    (LPCTSTR)path, size);
+  m_results.comment(key + L": " + str);
+}
+
+void CSuite::onCaseTiming(int pending, const CaseTiming& timing)
+{
+  // "<key>: time [host <ms>, ]load <ms>, lookup <ms>, ..." in ms.
+  CString str = m_cases.GetAt(m_pending[pending]) + L": time ";
+  CString part;
+  if (timing.hostStart)
+  {
+    part.Format(L"host %.1f, ", timing.hostStart / 1000.0);
+    str += part;
+  }
+  part.Format(L"load %.3f, lookup %.3f, setup %.3f, run %.3f, teardown %.3f",
+    timing.load / 1000.0, timing.lookup / 1000.0, timing.setup / 1000.0,
+    timing.run / 1000.0, timing.teardown / 1000.0);
+  m_results.comment(str + part);
+}
+
+void CSuite::onCaseResult(int pending, CaseResult result, uint32_t ms)
+{
+  int index = m_pending[pending];
+  m_journal.finish(m_cases.GetAt(index), result, ms);
+  if (result == kCaseSuccess || result == kCaseFail)
+  {
+    m_history->setLastResult(m_cases.GetAt(index), m_fingerprints.GetAt(index), result, ms);
+  }
+  else
+  {
+    m_history->clearLastResult(m_cases.GetAt(index));
+  }
+
+  m_results.write(m_cases.GetAt(index), result, ms);
+  m_sink->onCaseResult(index, result, ms);
+}
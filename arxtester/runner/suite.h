@@ -0,0 +1,87 @@
+#ifndef SUITE_H
+#define SUITE_H
+
+#include "hostpool.h"
+#include "results.h"
+#include "journal.h"
+
+class CCaseHistory;
+
+class ISuiteSink : public IHostPoolSink
+{
+public:
+  virtual void onCase(int index, const CString& name) = 0;
+};
+
+// One run of the enabled cases: selection, sharding, the host pool, the
+// history and the result file. Shared by the dialog and the headless
+// runner.
+//
+// Runs are incremental by default: every case remembers its last result
+// with the fingerprint of its module DLL and of the host, and a case whose
+// fingerprint did not change reports that result again instead of running.
+//
+// Every start and result is also appended to a journal, which is removed
+// once the run completes. A resumed run reports the results of the cases
+// the journal already finished and runs only the rest.
+class CSuite : private IHostPoolSink
+{
+public:
+  CSuite();
+  ~CSuite();
+
+  // A config.xml-style file selecting the cases; config.xml by default.
+  void setSuiteFile(const CString& file);
+  // Runs only shard `shard` (1-based) of `shards`, split by the wall times
+  // in weightsFile if there is one: a history.xml-style file that every
+  // shard reads but none writes (see shardCases()). Fails when the file
+  // cannot be read.
+  bool setShard(int shard, int shards, const CString& weightsFile);
+  // Runs every selected case even if a cached result could be reused.
+  void setFull(bool bFull);
+  // Continues the interrupted run of the same suite and shard, if any.
+  void setResume(bool bResume);
+
+  // Starts a new session (see newSessionId()) and picks the result file
+  // name in appDir() after it.
+  const CString& newResultFile();
+  void setResultFile(const CString& file);
+  const CString& resultFile() const;
+
+  const CString& caseKey(int index) const;
+
+  // Blocks until every case ran or hCancel is set; returns false when
+  // the run was cancelled.
+  bool run(HANDLE hCancel, ISuiteSink* sink);
+
+private:
+  CString journalFile() const;
+  void reuseResult(int index, CaseResult result, DWORD ms);
+
+  virtual void onCaseStart(int index);
+  virtual void onCaseLog(int index, const std::wstring& text);
+  virtual void onCaseArtifact(int index, const std::wstring& name, const void* data,
+    uint64_t size);
+  virtual void onCaseTiming(int index, const CaseTiming& timing);
+  virtual void onCaseResult(int index, CaseResult result, uint32_t ms);
+
+private:
+  CString m_suiteFile;
+  CString m_resultFile;
+  CString m_session;
+  int m_nShard;
+  int m_nShards;
+  std::unique_ptr<CCaseHistory> m_weights;
+  bool m_bFull;
+  bool m_bResume;
+
+  CStringArray m_cases;
+  CStringArray m_fingerprints;
+  std::vector<int> m_pending;
+  CCaseHistory* m_history;
+  CResultLog m_results;
+  CRunJournal m_journal;
+  ISuiteSink* m_sink;
+};
+
+#endif//SUITE_H